@@ -491,11 +491,23 @@ enum EThingSpecialActivationType
 	THINGSPEC_Switch			= 1<<10,	// The thing is alternatively activated and deactivated when triggered
 };
 
+// What P_ChangeSector last found for an actor's floor and ceiling, along
+// with everything that went into finding it. Not saved with the game.
+struct FPlaneCheck
+{
+	struct sector_t	*Sector;		// NULL if there is no usable check
+	fixed_t			X, Y, Z;
+	fixed_t			Radius, Height;
+	fixed_t			FloorZ, DropoffZ, CeilingZ;
+	struct line_t	*BlockingLine;	// what the check left in AActor::BlockingLine
+};
+
 // [RH] Like msecnode_t, but for the blockmap
 struct FBlockNode
 {
 	AActor *Me;						// actor this node references
 	int BlockIndex;					// index into blocklinks for the block this node is in
+	int ActorIndex;					// index into the block's blockactors entries
 	FBlockNode **PrevActor;			// previous actor in this block
 	FBlockNode *NextActor;			// next actor in this block
 	FBlockNode **PrevBlock;			// previous block this actor is in
@@ -854,6 +866,7 @@ public:
 	FTextureID		floorpic;			// contacted sec floorpic
 	struct sector_t	*ceilingsector;
 	FTextureID		ceilingpic;			// contacted sec ceilingpic
+	FPlaneCheck		LastPlaneCheck;		// for skipping unaffected actors in P_ChangeSector
 	fixed_t			radius, height;		// for movement checking
 	fixed_t			projectilepassheight;	// height for clipping projectile movement against this actor
 	fixed_t			velx, vely, velz;	// velocity
@@ -34,47 +34,213 @@
 ** It was, but the results were not as good as I would like, so I didn't
 ** actually use it. But I did keep the code around in case I ever felt like
 ** revisiting the problem. I never did, so now it's relegated to the mists
-** of SVN history, and this is just a thin wrapper around BestColor().
+** of SVN history, and this was just a thin wrapper around BestColor().
+**
+** Now the RGB cube is split into 32x32x32 cells, each of which remembers
+** the only palette entries that can possibly be closest to a color inside
+** it. A cell is built the first time it is picked from. Usually only one
+** or a handful of candidates are left, so later picks in the same cell
+** are nearly free, but since the candidates are still compared exactly,
+** the result is always the same one BestColor() would return.
 **
 */
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "doomtype.h"
+#include "templates.h"
 #include "colormatcher.h"
 #include "v_palette.h"
 
 FColorMatcher::FColorMatcher ()
 {
 	Pal = NULL;
+	Cells = NULL;
 }
 
 FColorMatcher::FColorMatcher (const DWORD *palette)
 {
+	Cells = NULL;
 	SetPalette (palette);
 }
 
 FColorMatcher::FColorMatcher (const FColorMatcher &other)
 {
+	Cells = NULL;
 	*this = other;
 }
 
+FColorMatcher::~FColorMatcher ()
+{
+	if (Cells != NULL)
+	{
+		delete[] Cells;
+	}
+}
+
 FColorMatcher &FColorMatcher::operator= (const FColorMatcher &other)
 {
-	Pal = other.Pal;
+	if (&other != this)
+	{
+		Pal = other.Pal;
+		ClearCells ();
+	}
 	return *this;
 }
 
 void FColorMatcher::SetPalette (const DWORD *palette)
 {
 	Pal = (const PalEntry *)palette;
+	ClearCells ();
 }
 
+//==========================================================================
+//
+// FColorMatcher :: ClearCells
+//
+// Forgets all cells. Must be called whenever the palette changes.
+//
+//==========================================================================
+
+void FColorMatcher::ClearCells ()
+{
+	if (Cells != NULL)
+	{
+		memset (Cells, 0xFF, NUM_CELLS * sizeof(*Cells));
+	}
+	CellLists.Clear ();
+}
+
+//==========================================================================
+//
+// FColorMatcher :: BuildCell
+//
+// A palette entry can only be the closest one for some color in the cell
+// if its distance to the nearest point of the cell is no greater than the
+// distance of some other entry to the farthest point. Every other entry
+// is dropped. Candidates are kept in palette order so that ties are
+// broken the same way BestColor() breaks them.
+//
+//==========================================================================
+
+DWORD FColorMatcher::BuildCell (int cell)
+{
+	int lo[3], hi[3];
+	int mindist[256];
+	int bestmax = INT_MAX;
+	int color, i;
+
+	lo[0] = (cell >> (CELL_BITS * 2)) << CELL_SHIFT;
+	lo[1] = ((cell >> CELL_BITS) & ((1 << CELL_BITS) - 1)) << CELL_SHIFT;
+	lo[2] = (cell & ((1 << CELL_BITS) - 1)) << CELL_SHIFT;
+	for (i = 0; i < 3; ++i)
+	{
+		hi[i] = lo[i] + (1 << CELL_SHIFT) - 1;
+	}
+
+	// Same range of entries as the BestColor() call in Pick.
+	for (color = 1; color < 255; ++color)
+	{
+		int c[3] = { Pal[color].r, Pal[color].g, Pal[color].b };
+		int mind = 0, maxd = 0;
+
+		for (i = 0; i < 3; ++i)
+		{
+			int closest = c[i] < lo[i] ? lo[i] - c[i] : c[i] > hi[i] ? c[i] - hi[i] : 0;
+			int farthest = MAX (abs(c[i] - lo[i]), abs(c[i] - hi[i]));
+			mind += closest * closest;
+			maxd += farthest * farthest;
+		}
+		mindist[color] = mind;
+		if (maxd < bestmax)
+		{
+			bestmax = maxd;
+		}
+	}
+
+	int count = 0, only = 1;
+	for (color = 1; color < 255; ++color)
+	{
+		if (mindist[color] <= bestmax)
+		{
+			if (count++ == 0) only = color;
+		}
+	}
+	if (count == 1)
+	{
+		return Cells[cell] = only;
+	}
+
+	unsigned int start = CellLists.Reserve (count + 1);
+	BYTE *list = &CellLists[start];
+	*list++ = (BYTE)count;
+	for (color = 1; color < 255; ++color)
+	{
+		if (mindist[color] <= bestmax)
+		{
+			*list++ = (BYTE)color;
+		}
+	}
+	return Cells[cell] = CELL_LIST + start;
+}
+
+//==========================================================================
+//
+// FColorMatcher :: Pick
+//
+//==========================================================================
+
 BYTE FColorMatcher::Pick (int r, int g, int b)
 {
 	if (Pal == NULL)
 		return 1;
 
-	return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	if ((r | g | b) & ~255)
+	{ // Out of range colors don't fit in any cell.
+		return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	}
+
+	if (Cells == NULL)
+	{
+		Cells = new DWORD[NUM_CELLS];
+		ClearCells ();
+	}
+
+	int cell = ((r >> CELL_SHIFT) << (CELL_BITS * 2)) | ((g >> CELL_SHIFT) << CELL_BITS) | (b >> CELL_SHIFT);
+	DWORD entry = Cells[cell];
+
+	if (entry == CELL_UNBUILT)
+	{
+		entry = BuildCell (cell);
+	}
+	if (entry < CELL_LIST)
+	{
+		return (BYTE)entry;
+	}
+
+	const BYTE *list = &CellLists[entry - CELL_LIST];
+	int count = *list++;
+	int bestcolor = list[0];
+	int bestdist = INT_MAX;
+
+	do
+	{
+		int color = *list++;
+		int x = r - Pal[color].r;
+		int y = g - Pal[color].g;
+		int z = b - Pal[color].b;
+		int dist = x*x + y*y + z*z;
+		if (dist < bestdist)
+		{
+			if (dist == 0)
+				return (BYTE)color;
+
+			bestdist = dist;
+			bestcolor = color;
+		}
+	} while (--count);
+
+	return (BYTE)bestcolor;
 }
@@ -34,12 +34,15 @@
 #ifndef __COLORMATCHER_H__
 #define __COLORMATCHER_H__
 
+#include "tarray.h"
+
 class FColorMatcher
 {
 public:
 	FColorMatcher ();
 	FColorMatcher (const DWORD *palette);
 	FColorMatcher (const FColorMatcher &other);
+	~FColorMatcher ();
 
 	void SetPalette (const DWORD *palette);
 	BYTE Pick (int r, int g, int b);
@@ -51,7 +54,21 @@ public:
 	FColorMatcher &operator= (const FColorMatcher &other);
 
 private:
+	enum
+	{
+		CELL_BITS = 5,
+		CELL_SHIFT = 8 - CELL_BITS,
+		NUM_CELLS = 1 << (CELL_BITS * 3),
+		CELL_LIST = 256,
+		CELL_UNBUILT = 0xFFFFFFFF
+	};
+
 	const PalEntry *Pal;
+	DWORD *Cells;			// palette index, or CELL_LIST + offset into CellLists
+	TArray<BYTE> CellLists;	// candidate count followed by the candidates
+
+	DWORD BuildCell (int cell);
+	void ClearCells ();
 };
 
 extern FColorMatcher ColorMatcher;
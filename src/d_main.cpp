@@ -106,6 +106,7 @@
 #include "po_man.h"
 #include "resourcefiles/resourcefile.h"
 #include "r_renderer.h"
+#include "m_benchmark.h"
 #include "p_local.h"
 #include "gl/scene/gl_offscreenbuffermanager.h"
 #include "gl/scene/rift_initializer.h"
@@ -923,6 +924,11 @@ void D_Display ()
 
 	cycles.Unclock();
 	FrameCycles = cycles;
+
+	if (benchmarking)
+	{
+		M_BenchFrame (cycles.TimeMS());
+	}
 }
 
 //==========================================================================
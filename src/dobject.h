@@ -263,6 +263,11 @@ namespace GC
 	// Size of GC steps.
 	extern int StepMul;
 
+	// Longest time in ms that steps may take per tic, or 0 for no limit.
+	// Single steps of the collector, like the atomic end of the mark
+	// phase, can't be cut, so they may go over.
+	extern double StepTimeLimit;
+
 	// Current white value for known-dead objects.
 	static inline uint32 OtherWhite()
 	{
@@ -337,6 +342,13 @@ namespace GC
 	template<class T> void Mark(TObjPtr<T> &obj);
 }
 
+// Size class pools that DObjects are allocated from (dobjpool.cpp).
+namespace ObjectPool
+{
+	void *Alloc(size_t size, const PClass *type = NULL);
+	void Free(void *mem);
+}
+
 // A template class to help with handling read barriers. It does not
 // handle write barriers, because those can be handled more efficiently
 // with knowledge of the object that holds the pointer.
@@ -492,12 +504,12 @@ public:
 
 	void *operator new(size_t len)
 	{
-		return M_Malloc(len);
+		return ObjectPool::Alloc(len);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		ObjectPool::Free(mem);
 	}
 
 	// GC fiddling
@@ -564,7 +576,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		ObjectPool::Free (mem);
 	}
 };
 
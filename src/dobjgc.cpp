@@ -69,6 +69,7 @@
 #include "s_sndseq.h"
 #include "r_data/r_interpolate.h"
 #include "doomstat.h"
+#include "i_system.h"
 #include "m_argv.h"
 #include "po_man.h"
 #include "v_video.h"
@@ -96,6 +97,13 @@
 */
 #define DEFAULT_GCMUL		400 // GC runs 'quadruple the speed' of memory allocation
 
+// Steps stop early once they have run this many milliseconds within one
+// tic, no matter how much work they were supposed to do. Whatever they
+// didn't get to is picked up in the following tics, since the debt they
+// were paying off remains. A single step of the collector, such as the
+// atomic end of the mark phase, can't be cut, so one of those can go over.
+#define DEFAULT_GCSTEPTIME	1.0
+
 // Number of sectors to mark for each step.
 #define SECTORSTEPSIZE	32
 #define POLYSTEPSIZE 120
@@ -148,12 +156,17 @@ DWORD CurrentWhite = OF_White0 | OF_Fixed;
 EGCState State = GCS_Pause;
 int Pause = DEFAULT_GCPAUSE;
 int StepMul = DEFAULT_GCMUL;
+double StepTimeLimit = DEFAULT_GCSTEPTIME;
 int StepCount;
 size_t Dept;
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 static DSectorMarker *SectorMarker;
+static double MaxStepTime, CycleMaxStepTime;
+static int CycleSteps, CycleCutSteps, LastCycleSteps, LastCycleCutSteps;
+static unsigned TicStart;		// real time the current tic's step budget began
+static double TicStepTime;		// time spent in steps since then
 
 // CODE --------------------------------------------------------------------
 
@@ -392,6 +405,11 @@ static size_t SingleStep()
 	{
 	case GCS_Pause:
 		MarkRoot();		// Start a new collection
+		MaxStepTime = CycleMaxStepTime;
+		LastCycleSteps = CycleSteps;
+		LastCycleCutSteps = CycleCutSteps;
+		CycleMaxStepTime = 0;
+		CycleSteps = CycleCutSteps = 0;
 		return 0;
 
 	case GCS_Propagate:
@@ -434,7 +452,7 @@ static size_t SingleStep()
 // Step
 //
 // Performs enough single steps to cover GCSTEPSIZE * StepMul% bytes of
-// memory.
+// memory, as far as the time left in this tic allows.
 //
 //==========================================================================
 
@@ -442,17 +460,62 @@ void Step()
 {
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
+	cycle_t time;
+	bool cut = false;
+
 	if (lim == 0)
 	{
 		lim = (~(size_t)0) / 2;		// no limit
 	}
 	Dept += AllocBytes - Threshold;
+
+	unsigned now = I_MSTime();
+	if (now - TicStart >= 1000 / TICRATE)
+	{
+		TicStart = now;
+		TicStepTime = 0;
+	}
+	if (StepTimeLimit > 0 && TicStepTime >= StepTimeLimit)
+	{ // This tic's time is used up. Try again after another GCSTEPSIZE
+	  // bytes, which are owed as well.
+		Dept += GCSTEPSIZE;
+		Threshold = AllocBytes + GCSTEPSIZE;
+		return;
+	}
+
+	time.Reset();
+	time.Clock();
 	do
 	{
 		olim = lim;
 		lim -= SingleStep();
-	} while (olim > lim && State != GCS_Pause);
-	if (State != GCS_Pause)
+		if (StepTimeLimit > 0)
+		{
+			time.Unclock();
+			cut = TicStepTime + time.TimeMS() >= StepTimeLimit;
+			time.Clock();
+		}
+	} while (olim > lim && State != GCS_Pause && !cut);
+	time.Unclock();
+	TicStepTime += time.TimeMS();
+	CycleMaxStepTime = MAX(CycleMaxStepTime, time.TimeMS());
+	CycleSteps++;
+	cut = cut && olim > lim && State != GCS_Pause;
+	if (cut)
+	{
+		CycleCutSteps++;
+
+		// Only the part of the step that got done pays off debt; the rest
+		// is owed again. Since this tic's time is used up, collecting
+		// resumes after another GCSTEPSIZE bytes. Those are owed too, which
+		// cancels out the GCSTEPSIZE this step would have paid off.
+		if (StepMul > 0)
+		{
+			Dept += lim * 100 / StepMul;
+		}
+		Threshold = AllocBytes + GCSTEPSIZE;
+	}
+	else if (State != GCS_Pause)
 	{
 		if (Dept < GCSTEPSIZE)
 		{
@@ -719,6 +782,8 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("\nLast cycle: %d steps, %d cut short, longest %.2f ms (single steps can't be cut)",
+		GC::LastCycleSteps, GC::LastCycleCutSteps, GC::MaxStepTime);
 	return out;
 }
 
@@ -734,7 +799,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]|steptime [ms]\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -771,4 +836,15 @@ CCMD(gc)
 			GC::StepMul = MAX(100, atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "steptime") == 0)
+	{
+		if (argv.argc() == 2)
+		{
+			Printf ("Current GC step time limit is %g ms per tic\n", GC::StepTimeLimit);
+		}
+		else
+		{
+			GC::StepTimeLimit = MAX(0., atof(argv[2]));
+		}
+	}
 }
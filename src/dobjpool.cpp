@@ -0,0 +1,249 @@
+/*
+** dobjpool.cpp
+** Size class pools for the memory of DObjects
+**
+**---------------------------------------------------------------------------
+**
+** Objects up to POOL_MAXSIZE bytes are carved from chunks that each serve
+** one size class. Sizes are rounded up to whole cache lines and chunks are
+** aligned to their own size, so every object starts on a cache line and
+** the chunk an object lives in can be found from its address alone.
+** Freed slots go onto their size class's free list and are handed out
+** again before a new chunk is allocated. Chunks are kept for the rest of
+** the session, so memory used for a burst of short lived actors is reused
+** instead of being left for the heap to fragment. Larger objects go
+** through M_Malloc as before.
+**
+** Pooled memory is counted in GC::AllocBytes the same way M_Malloc'd
+** memory is, so the collector's pacing is not affected.
+**
+*/
+
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "doomtype.h"
+#include "dobject.h"
+#include "m_alloc.h"
+#include "i_system.h"
+#include "c_dispatch.h"
+#include "tarray.h"
+#include "templates.h"
+
+enum
+{
+	POOL_CHUNKSHIFT = 16,
+	POOL_CHUNKSIZE = 1 << POOL_CHUNKSHIFT,
+	POOL_GRANULARITY = 64,
+	POOL_MAXSIZE = 4096,
+	POOL_NUMCLASSES = POOL_MAXSIZE / POOL_GRANULARITY
+};
+
+struct FPoolSlot
+{
+	FPoolSlot *Next;
+};
+
+struct FObjectPool
+{
+	FPoolSlot *FreeList;
+	size_t SlotSize;
+	unsigned Live, Peak, Chunks;
+	QWORD Allocs;
+};
+
+struct FClassAllocs
+{
+	QWORD Count;
+	QWORD Bytes;
+};
+
+static FObjectPool Pools[POOL_NUMCLASSES];
+static TMap<size_t, FObjectPool *> PoolChunks;
+static TMap<const PClass *, FClassAllocs> ClassAllocs;
+static QWORD LargeAllocs;
+
+//==========================================================================
+//
+// AllocChunk
+//
+//==========================================================================
+
+static BYTE *AllocChunk ()
+{
+	void *mem;
+#ifdef _WIN32
+	mem = _aligned_malloc (POOL_CHUNKSIZE, POOL_CHUNKSIZE);
+#else
+	if (posix_memalign (&mem, POOL_CHUNKSIZE, POOL_CHUNKSIZE) != 0)
+	{
+		mem = NULL;
+	}
+#endif
+	if (mem == NULL)
+	{
+		I_FatalError ("Could not allocate a %d byte object pool chunk", POOL_CHUNKSIZE);
+	}
+	return (BYTE *)mem;
+}
+
+//==========================================================================
+//
+// AddChunk
+//
+// Gives the pool a new chunk and puts all its slots on the free list, in
+// address order.
+//
+//==========================================================================
+
+static void AddChunk (FObjectPool *pool)
+{
+	BYTE *chunk = AllocChunk ();
+	int count = int(POOL_CHUNKSIZE / pool->SlotSize);
+
+	for (int i = count - 1; i >= 0; --i)
+	{
+		FPoolSlot *slot = (FPoolSlot *)(chunk + i * pool->SlotSize);
+		slot->Next = pool->FreeList;
+		pool->FreeList = slot;
+	}
+	PoolChunks[(size_t)chunk >> POOL_CHUNKSHIFT] = pool;
+	pool->Chunks++;
+}
+
+//==========================================================================
+//
+// ObjectPool :: Alloc
+//
+// type is only used for the statistics and may be NULL.
+//
+//==========================================================================
+
+void *ObjectPool::Alloc (size_t size, const PClass *type)
+{
+	void *mem;
+
+	if (type != NULL)
+	{
+		FClassAllocs &allocs = ClassAllocs[type];
+		allocs.Count++;
+		allocs.Bytes += size;
+	}
+	if (size > POOL_MAXSIZE)
+	{
+		LargeAllocs++;
+		return M_Malloc (size);
+	}
+
+	FObjectPool *pool = &Pools[(MAX<size_t> (size, 1) - 1) / POOL_GRANULARITY];
+
+	if (pool->SlotSize == 0)
+	{
+		pool->SlotSize = (pool - Pools + 1) * POOL_GRANULARITY;
+	}
+	if (pool->FreeList == NULL)
+	{
+		AddChunk (pool);
+	}
+	mem = pool->FreeList;
+	pool->FreeList = pool->FreeList->Next;
+	pool->Allocs++;
+	if (++pool->Live > pool->Peak)
+	{
+		pool->Peak = pool->Live;
+	}
+	GC::AllocBytes += pool->SlotSize;
+	return mem;
+}
+
+//==========================================================================
+//
+// ObjectPool :: Free
+//
+//==========================================================================
+
+void ObjectPool::Free (void *mem)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	FObjectPool **ppool = PoolChunks.CheckKey ((size_t)mem >> POOL_CHUNKSHIFT);
+
+	if (ppool == NULL)
+	{
+		M_Free (mem);
+		return;
+	}
+
+	FObjectPool *pool = *ppool;
+	FPoolSlot *slot = (FPoolSlot *)mem;
+
+	slot->Next = pool->FreeList;
+	pool->FreeList = slot;
+	pool->Live--;
+	GC::AllocBytes -= pool->SlotSize;
+}
+
+//==========================================================================
+//
+// CCMD objectpools
+//
+// Lists the size classes that are in use and the classes that allocated
+// the most objects.
+//
+//==========================================================================
+
+struct FClassAllocEntry
+{
+	const PClass *Type;
+	FClassAllocs Allocs;
+};
+
+static int STACK_ARGS CompareClassAllocs (const void *a, const void *b)
+{
+	QWORD ca = ((const FClassAllocEntry *)a)->Allocs.Count, cb = ((const FClassAllocEntry *)b)->Allocs.Count;
+	return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+CCMD (objectpools)
+{
+	int count = argv.argc() > 1 ? atoi (argv[1]) : 20;
+	size_t total = 0;
+
+	Printf ("Size   Live   Peak Chunks      Allocs\n");
+	for (int i = 0; i < POOL_NUMCLASSES; ++i)
+	{
+		const FObjectPool *pool = &Pools[i];
+		if (pool->Chunks > 0)
+		{
+			Printf ("%4zu %6u %6u %6u %11llu\n", pool->SlotSize, pool->Live, pool->Peak, pool->Chunks,
+				(unsigned long long)pool->Allocs);
+			total += pool->Chunks;
+		}
+	}
+	Printf ("%zu KB in chunks, %llu larger objects allocated\n", (total * POOL_CHUNKSIZE) >> 10,
+		(unsigned long long)LargeAllocs);
+
+	TArray<FClassAllocEntry> entries;
+	TMap<const PClass *, FClassAllocs>::Iterator it(ClassAllocs);
+	TMap<const PClass *, FClassAllocs>::Pair *pair;
+
+	while (it.NextPair (pair))
+	{
+		FClassAllocEntry entry = { pair->Key, pair->Value };
+		entries.Push (entry);
+	}
+	if (entries.Size() > 1)
+	{
+		qsort (&entries[0], entries.Size(), sizeof(FClassAllocEntry), CompareClassAllocs);
+	}
+	for (unsigned i = 0; i < entries.Size() && (int)i < count; ++i)
+	{
+		Printf ("%11llu %8llu KB  %s\n", (unsigned long long)entries[i].Allocs.Count,
+			(unsigned long long)(entries[i].Allocs.Bytes >> 10), entries[i].Type->TypeName.GetChars());
+	}
+}
@@ -39,6 +39,7 @@
 #include "i_system.h"
 #include "doomerrors.h"
 #include "farchive.h"
+#include "p_profile.h"
 
 
 static cycle_t ThinkCycles;
@@ -413,6 +414,10 @@ void DThinker::RunThinkers ()
 	// Tick every thinker left from last time
 	for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 	{
+		if (i == STAT_DEFAULT)
+		{
+			P_PrefetchSightChecks ();
+		}
 		TickThinkers (&Thinkers[i], NULL);
 	}
 
@@ -427,6 +432,7 @@ void DThinker::RunThinkers ()
 	} while (count != 0);
 
 	ThinkCycles.Unclock();
+	P_ProfileTicDone ();
 }
 
 int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
@@ -460,7 +466,14 @@ int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
 
 		if (!(node->ObjectFlags & OF_EuthanizeMe))
 		{ // Only tick thinkers not scheduled for destruction
-			node->Tick();
+			if (ThinkProfiling)
+			{
+				P_ProfileTick (node);
+			}
+			else
+			{
+				node->Tick();
+			}
 			node->ObjectFlags &= ~OF_JustSpawned;
 			GC::CheckGC();
 		}
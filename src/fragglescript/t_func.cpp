@@ -2283,7 +2283,7 @@ void FParser::SF_SetLineBlocking(void)
 			int tag=intvalue(t_argv[0]);
 			for (int i = -1; (i = P_FindLineFromID(tag, i)) >= 0;) 
 			{
-				lines[i].flags = (lines[i].flags & ~(ML_BLOCKING|ML_BLOCKEVERYTHING)) | blocking;
+				P_SetLineFlags (&lines[i], ML_BLOCKING|ML_BLOCKEVERYTHING, blocking);
 			}
 		}
 	}
@@ -4369,6 +4369,8 @@ void FParser::SF_SetLineTrigger()
 										(f & ~(ML_MONSTERSCANACTIVATE|ML_REPEAT_SPECIAL|ML_SPAC_MASK|ML_FIRSTSIDEONLY));
 
 		}
+		// The IDs may have changed.
+		P_InitTagLists();
 	}
 }
 
@@ -4391,16 +4393,8 @@ void FParser::SF_ChangeTag()
 			sectors[secnum].tag=t_argv[1].value.i;
 		}
 
-		// Recreate the hash tables
-		int i;
-
-		for (i=numsectors; --i>=0; ) sectors[i].firsttag = -1;
-		for (i=numsectors; --i>=0; )
-		{
-			int j = (unsigned) sectors[i].tag % (unsigned) numsectors;
-			sectors[i].nexttag = sectors[j].firsttag;
-			sectors[j].firsttag = i;
-		}
+		// Recreate the tag index
+		P_InitTagLists();
 	}
 }
 
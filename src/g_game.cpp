@@ -80,6 +80,7 @@
 #include "m_joy.h"
 #include "farchive.h"
 #include "r_renderer.h"
+#include "m_benchmark.h"
 #include "r_data/colormaps.h"
 
 #include <zlib.h>
@@ -2705,6 +2706,12 @@ void G_TimeDemo (const char* name)
 	timingdemo = true;
 	singletics = true;
 
+	const char *report = Args->CheckValue ("-benchreport");
+	if (report != NULL)
+	{
+		M_BenchStart (report);
+	}
+
 	defdemoname = name;
 	gameaction = (gameaction == ga_loadgame) ? ga_loadgameplaydemo : ga_playdemo;
 }
@@ -2754,7 +2761,16 @@ bool G_CheckDemoStatus (void)
 		}
 		if (singledemo || timingdemo)
 		{
-			if (timingdemo)
+			if (timingdemo && benchmarking)
+			{
+				// Scripted runs want a clean exit, not an error dialog. The
+				// exit code tells them whether the report was written.
+				bool written = M_BenchWriteReport (defdemoname, gametic, endtime);
+				Printf ("timed %i gametics in %i realtics (%.1f fps)\n",
+					gametic, endtime, (float)gametic/(float)endtime*(float)TICRATE);
+				exit (written ? 0 : 1);
+			}
+			else if (timingdemo)
 			{
 				// Trying to get back to a stable state after timing a demo
 				// seems to cause problems. I don't feel like fixing that
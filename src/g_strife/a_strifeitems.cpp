@@ -30,7 +30,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_RemoveForceField)
 		line_t *line = self->Sector->lines[i];
 		if (line->backsector != NULL && line->special == ForceField)
 		{
-			line->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
+			P_SetLineFlags (line, ML_BLOCKING|ML_BLOCKEVERYTHING, 0);
 			line->special = 0;
 			line->sidedef[0]->SetTexture(side_t::mid, FNullTextureID());
 			line->sidedef[1]->SetTexture(side_t::mid, FNullTextureID());
@@ -87,6 +87,195 @@ FVertexBuffer::~FVertexBuffer()
 	}
 }
 
+//==========================================================================
+//
+// Streaming buffer
+//
+//==========================================================================
+
+FStreamBuffer::FStreamBuffer(unsigned int size)
+: FVertexBuffer()
+{
+	mSegmentSize = (size / NUM_SEGMENTS) & ~(ALIGNMENT-1);
+	mSize = mSegmentSize * NUM_SEGMENTS;
+	mSegment = 0;
+	mOffset = 0;
+	mMapOffset = 0;
+	mMapSize = 0;
+	mMapped = false;
+	mPersistentMap = NULL;
+	memset(mFences, 0, sizeof(mFences));
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+	if (gl.flags & RFL_BUFFER_STORAGE)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, mSize, NULL, flags);
+		mPersistentMap = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, mSize, flags);
+		if (mPersistentMap == NULL)
+		{
+			// Immutable storage cannot be respecified so start over with a new buffer.
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glDeleteBuffers(1, &vbo_id);
+			glGenBuffers(1, &vbo_id);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+		}
+	}
+	if (mPersistentMap == NULL)
+	{
+		glBufferData(GL_ARRAY_BUFFER, mSize, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+FStreamBuffer::~FStreamBuffer()
+{
+	for (int i = 0; i < NUM_SEGMENTS; i++)
+	{
+		if (mFences[i] != NULL) glDeleteSync(mFences[i]);
+	}
+	if (mPersistentMap != NULL)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+//==========================================================================
+//
+// Returns a pointer to 'bytes' bytes of writable buffer space or NULL
+// if this frame's segment is exhausted. In that case the caller has to
+// fall back to immediate mode.
+//
+//==========================================================================
+
+void *FStreamBuffer::Map(unsigned int bytes)
+{
+	assert(!mMapped);
+
+	unsigned int offset = (mOffset + ALIGNMENT - 1) & ~(ALIGNMENT-1);
+	unsigned int limit = mPersistentMap != NULL? mSegmentSize : mSize;
+	if (offset + bytes > limit) return NULL;
+
+	mMapOffset = offset;
+	mMapSize = bytes;
+	mOffset = offset + bytes;
+	mMapped = true;
+
+	if (mPersistentMap != NULL)
+	{
+		mMapOffset += mSegment * mSegmentSize;
+		return mPersistentMap + mMapOffset;
+	}
+	else if (gl.flags & RFL_MAP_BUFFER_RANGE)
+	{
+		// The buffer was orphaned at the start of the frame and no range is
+		// handed out twice so there is nothing to synchronize with.
+		GLint prev;
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prev);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+		void *p = glMapBufferRange(GL_ARRAY_BUFFER, mMapOffset, bytes, 
+			GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_RANGE_BIT|GL_MAP_UNSYNCHRONIZED_BIT);
+		glBindBuffer(GL_ARRAY_BUFFER, prev);
+		if (p == NULL) mMapped = false;
+		return p;
+	}
+	else
+	{
+		mScratch.Resize(bytes);
+		return &mScratch[0];
+	}
+}
+
+//==========================================================================
+//
+// Finishes writing and returns the buffer offset of the mapped range
+// which is what gl*Pointer needs while this buffer is bound.
+//
+//==========================================================================
+
+unsigned int FStreamBuffer::Unmap()
+{
+	if (mMapped)
+	{
+		mMapped = false;
+		if (mPersistentMap == NULL)
+		{
+			GLint prev;
+			glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prev);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+			if (gl.flags & RFL_MAP_BUFFER_RANGE)
+			{
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+			}
+			else
+			{
+				glBufferSubData(GL_ARRAY_BUFFER, mMapOffset, mMapSize, &mScratch[0]);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, prev);
+		}
+	}
+	return mMapOffset;
+}
+
+//==========================================================================
+//
+// Must be called once after all of a frame's draw calls have been issued.
+// The map and unmap calls leave the GL_ARRAY_BUFFER binding alone, so this
+// does as well.
+//
+//==========================================================================
+
+void FStreamBuffer::NextFrame()
+{
+	// If nothing was allocated this frame, the buffer and the current
+	// segment are still free.
+	if (mOffset == 0) return;
+
+	if (mPersistentMap != NULL)
+	{
+		if (mFences[mSegment] != NULL) glDeleteSync(mFences[mSegment]);
+		mFences[mSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		mSegment = (mSegment + 1) % NUM_SEGMENTS;
+
+		// The next segment was last used NUM_SEGMENTS-1 frames ago so
+		// this should practically never have to wait.
+		if (mFences[mSegment] != NULL)
+		{
+			GLenum res;
+			do
+			{
+				res = glClientWaitSync(mFences[mSegment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+			while (res == GL_TIMEOUT_EXPIRED);
+			glDeleteSync(mFences[mSegment]);
+			mFences[mSegment] = NULL;
+		}
+	}
+	else
+	{
+		GLint prev;
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prev);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+		glBufferData(GL_ARRAY_BUFFER, mSize, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, prev);
+	}
+	mOffset = 0;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FStreamBuffer::BindVBO()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
 //==========================================================================
 //
 //
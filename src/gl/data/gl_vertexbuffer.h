@@ -7,6 +7,7 @@ struct vertex_t;
 struct secplane_t;
 struct subsector_t;
 struct sector_t;
+struct __GLsync;
 
 
 class FVertexBuffer
@@ -20,6 +21,46 @@ public:
 	virtual void BindVBO() = 0;
 };
 
+//==========================================================================
+//
+// Ring buffer for vertex data that is generated anew each frame.
+// The buffer is split into one segment per frame in flight. With
+// ARB_buffer_storage it stays mapped permanently and a fence guards
+// each segment against being overwritten while the GPU still reads it.
+// Without it the buffer is orphaned once per frame instead.
+//
+//==========================================================================
+
+class FStreamBuffer : public FVertexBuffer
+{
+	enum
+	{
+		NUM_SEGMENTS = 3,
+		ALIGNMENT = 16
+	};
+
+	unsigned int mSize;
+	unsigned int mSegmentSize;
+	unsigned int mSegment;
+	unsigned int mOffset;		// allocation position inside the current segment
+	unsigned int mMapOffset;	// start of the range returned by the last Map call
+	unsigned int mMapSize;
+	unsigned char *mPersistentMap;
+	bool mMapped;
+	TArray<unsigned char> mScratch;	// used when the GL has neither persistent mapping nor map_buffer_range
+	__GLsync *mFences[NUM_SEGMENTS];
+
+public:
+	FStreamBuffer(unsigned int size);
+	~FStreamBuffer();
+
+	void *Map(unsigned int bytes);
+	unsigned int Unmap();
+	void NextFrame();
+	void BindVBO();
+	bool IsPersistent() const { return mPersistentMap != NULL; }
+};
+
 struct FFlatVertex	// exactly 32 bytes large
 {
 	float x,z,y,w;	// w only for padding to make one vertex 32 bytes - maybe it will find some use later
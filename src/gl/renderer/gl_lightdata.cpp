@@ -56,14 +56,24 @@
 // externally settable lighting properties
 static float distfogtable[2][256];	// light to fog conversion table for black fog
 static PalEntry outsidefogcolor;
+static DWORD outsidefogkey = 0xffffffff;	// RGB of the outside fog, or a value no color can match if there is none
 int fogdensity;
 int outsidefogdensity;
 int skyfog;
 
+// Light levels and fog densities only depend on a few CVARs and the level's fog
+// settings, so they are looked up from tables indexed by light mode and light level.
+// LIGHT_AMBIENT marks light levels that got raised to the ambient level.
+enum { LIGHT_AMBIENT = 0x10000 };
+static int lighttable[9][2][256];		// [lightmode][weapon][lightlevel]
+static float fogtable[9][2][256];		// [lightmode][colored fog][lightlevel]
+static bool lighttablesvalid;
+
 CUSTOM_CVAR (Int, gl_light_ambient, 20, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
 	// ambient of 0 does not work correctly because light level 0 is special.
 	if (self < 1) self = 1;
+	lighttablesvalid = false;
 }
 
 CVAR(Int, gl_weaponlight, 8, CVAR_ARCHIVE);
@@ -119,6 +129,7 @@ CUSTOM_CVAR (Int, gl_distfog, 70, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 		}
 		else distfogtable[1][i]=0;
 	}
+	lighttablesvalid = false;
 }
 
 CUSTOM_CVAR(Int,gl_fogmode,1,CVAR_ARCHIVE|CVAR_NOINITCALL)
@@ -202,9 +213,105 @@ void gl_SetFogParams(int _fogdensity, PalEntry _outsidefogcolor, int _outsidefog
 
 	outsidefogdensity>>=1;
 	fogdensity>>=1;
+
+	// black fog never counts as outside fog
+	outsidefogkey = outsidefogcolor.d & 0xffffff;
+	if (outsidefogdensity == 0 || outsidefogcolor.a == 0xff || outsidefogkey == 0) outsidefogkey = 0xffffffff;
+	lighttablesvalid = false;
 }
 
 
+//==========================================================================
+//
+// Light level before applying relative light
+//
+//==========================================================================
+
+static int gl_CalcBaseLight(int lightmode, int lightlevel, bool weapon)
+{
+	int light;
+
+	if ((lightmode & 2) && lightlevel < 192 && !weapon) 
+	{
+		light = xs_CRoundToInt(192.f - (192-lightlevel)* 1.95f);
+	}
+	else
+	{
+		light=lightlevel;
+	}
+
+	if (light<gl_light_ambient && lightmode != 8)		// ambient clipping only if not using software lighting model.
+	{
+		light = gl_light_ambient | LIGHT_AMBIENT;
+	}
+	return light;
+}
+
+//==========================================================================
+//
+// Fog density for everything but the outside fog
+//
+//==========================================================================
+
+static float gl_CalcFogDensity(int lightmode, int lightlevel, bool blackfog)
+{
+	float density;
+
+	if (lightmode&4)
+	{
+		// uses approximations of Legacy's default settings.
+		density = fogdensity? fogdensity : 18;
+	}
+	else if (blackfog)
+	{
+		// case 1: black fog
+		if (lightmode != 8)
+		{
+			density=distfogtable[lightmode!=0][gl_ClampLight(lightlevel)];
+		}
+		else
+		{
+			density = 0;
+		}
+	}
+	else  if (fogdensity!=0)
+	{
+		// case 3: level has fog density set
+		density=fogdensity;
+	}
+	else if (lightlevel < 248)
+	{
+		// case 4: use light level
+		density=clamp<int>(255-lightlevel,30,255);
+	}
+	else 
+	{
+		density = 0.f;
+	}
+	return density;
+}
+
+//==========================================================================
+//
+// Rebuilds the light level and fog density tables
+//
+//==========================================================================
+
+static void gl_BuildLightTables()
+{
+	for (int mode = 0; mode < 9; mode++)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			lighttable[mode][0][i] = gl_CalcBaseLight(mode, i, false);
+			lighttable[mode][1][i] = gl_CalcBaseLight(mode, i, true);
+			fogtable[mode][0][i] = gl_CalcFogDensity(mode, i, true);
+			fogtable[mode][1][i] = gl_CalcFogDensity(mode, i, false);
+		}
+	}
+	lighttablesvalid = true;
+}
+
 //==========================================================================
 //
 // Get current light level
@@ -217,18 +324,19 @@ int gl_CalcLightLevel(int lightlevel, int rellight, bool weapon)
 
 	if (lightlevel == 0) return 0;
 
-	if ((glset.lightmode & 2) && lightlevel < 192 && !weapon) 
+	if ((unsigned)lightlevel < 256)
 	{
-		light = xs_CRoundToInt(192.f - (192-lightlevel)* 1.95f);
+		if (!lighttablesvalid) gl_BuildLightTables();
+		light = lighttable[glset.lightmode][weapon][lightlevel];
 	}
 	else
 	{
-		light=lightlevel;
+		light = gl_CalcBaseLight(glset.lightmode, lightlevel, weapon);
 	}
 
-	if (light<gl_light_ambient && glset.lightmode != 8)		// ambient clipping only if not using software lighting model.
+	if (light & LIGHT_AMBIENT)
 	{
-		light = gl_light_ambient;
+		light &= ~LIGHT_AMBIENT;
 		if (rellight<0) rellight>>=1;
 	}
 	return clamp(light+rellight, 0, 255);
@@ -370,45 +478,19 @@ void gl_SetColor(int light, int rellight, const FColormap * cm, float alpha, Pal
 
 float gl_GetFogDensity(int lightlevel, PalEntry fogcolor)
 {
-	float density;
+	DWORD fogrgb = fogcolor.d & 0xffffff;
 
-	if (glset.lightmode&4)
-	{
-		// uses approximations of Legacy's default settings.
-		density = fogdensity? fogdensity : 18;
-	}
-	else if ((fogcolor.d & 0xffffff) == 0)
-	{
-		// case 1: black fog
-		if (glset.lightmode != 8)
-		{
-			density=distfogtable[glset.lightmode!=0][lightlevel];
-		}
-		else
-		{
-			density = 0;
-		}
-	}
-	else if (outsidefogdensity != 0 && outsidefogcolor.a!=0xff && (fogcolor.d & 0xffffff) == (outsidefogcolor.d & 0xffffff))
+	if (fogrgb == outsidefogkey && !(glset.lightmode&4))
 	{
 		// case 2. outsidefogdensity has already been set as needed
-		density=outsidefogdensity;
+		return outsidefogdensity;
 	}
-	else  if (fogdensity!=0)
+	if ((unsigned)lightlevel < 256)
 	{
-		// case 3: level has fog density set
-		density=fogdensity;
-	}
-	else if (lightlevel < 248)
-	{
-		// case 4: use light level
-		density=clamp<int>(255-lightlevel,30,255);
-	}
-	else 
-	{
-		density = 0.f;
+		if (!lighttablesvalid) gl_BuildLightTables();
+		return fogtable[glset.lightmode][fogrgb != 0][lightlevel];
 	}
-	return density;
+	return gl_CalcFogDensity(glset.lightmode, lightlevel, fogrgb == 0);
 }
 
 
@@ -429,7 +511,7 @@ bool gl_CheckFog(FColormap *cm, int lightlevel)
 	{
 		frontfog = false;
 	}
-	else if (outsidefogdensity != 0 && outsidefogcolor.a!=0xff && (fogcolor.d & 0xffffff) == (outsidefogcolor.d & 0xffffff))
+	else if ((fogcolor.d & 0xffffff) == outsidefogkey)
 	{
 		frontfog = true;
 	}
@@ -463,7 +545,7 @@ bool gl_CheckFog(sector_t *frontsector, sector_t *backsector)
 	{
 		frontfog = false;
 	}
-	else if (outsidefogdensity != 0 && outsidefogcolor.a!=0xff && (fogcolor.d & 0xffffff) == (outsidefogcolor.d & 0xffffff))
+	else if ((fogcolor.d & 0xffffff) == outsidefogkey)
 	{
 		frontfog = true;
 	}
@@ -486,7 +568,7 @@ bool gl_CheckFog(sector_t *frontsector, sector_t *backsector)
 	{
 		backfog = false;
 	}
-	else if (outsidefogdensity != 0 && outsidefogcolor.a!=0xff && (fogcolor.d & 0xffffff) == (outsidefogcolor.d & 0xffffff))
+	else if ((fogcolor.d & 0xffffff) == outsidefogkey)
 	{
 		backfog = true;
 	}
@@ -76,6 +76,9 @@
 
 EXTERN_CVAR(Bool, gl_render_segs)
 
+// 1 MB of streamed vertex data per frame in flight
+enum { STREAM_BUFFER_SIZE = 3 * 1024 * 1024 };
+
 //-----------------------------------------------------------------------------
 //
 // Initialize
@@ -89,10 +92,12 @@ FGLRenderer::FGLRenderer(OpenGLFrameBuffer *fb)
 	mMirrorCount = 0;
 	mPlaneMirrorCount = 0;
 	mLightCount = 0;
+	mViewFoV = 90.f;
 	mAngles = FRotator(0,0,0);
 	mViewVector = FVector2(0,0);
 	mCameraPos = FVector3(0,0,0);
 	mVBO = NULL;
+	mStreamBuffer = NULL;
 	gl_spriteindex = 0;
 	mShaderManager = NULL;
 	glpart2 = glpart = gllight = mirrortexture = NULL;
@@ -106,6 +111,7 @@ void FGLRenderer::Initialize()
 	gllight = FTexture::CreateTexture(Wads.GetNumForFullName("glstuff/gllight.png"), FTexture::TEX_MiscPatch);
 
 	mVBO = new FFlatVertexBuffer;
+	mStreamBuffer = new FStreamBuffer(STREAM_BUFFER_SIZE);
 	mFBID = 0;
 	SetupLevel();
 	mShaderManager = new FShaderManager;
@@ -120,6 +126,7 @@ FGLRenderer::~FGLRenderer()
 	//if (mThreadManager != NULL) delete mThreadManager;
 	if (mShaderManager != NULL) delete mShaderManager;
 	if (mVBO != NULL) delete mVBO;
+	if (mStreamBuffer != NULL) delete mStreamBuffer;
 	if (glpart2) delete glpart2;
 	if (glpart) delete glpart;
 	if (mirrortexture) delete mirrortexture;
@@ -9,6 +9,7 @@
 struct particle_t;
 class FCanvasTexture;
 class FFlatVertexBuffer;
+class FStreamBuffer;
 class OpenGLFrameBuffer;
 struct FDrawInfo;
 struct pspdef_t;
@@ -51,6 +52,7 @@ public:
 	int mPlaneMirrorCount;
 	int mLightCount;
 	float mCurrentFoV;
+	float mViewFoV;		// FoV of the last main view, for measuring camera textures
 	AActor *mViewActor;
 	FShaderManager *mShaderManager;
 	FGLThreadManager *mThreadManager;
@@ -69,6 +71,7 @@ public:
 	FVector3 mCameraPos;
 
 	FFlatVertexBuffer *mVBO;
+	FStreamBuffer *mStreamBuffer;
 
 	FGLRenderer(OpenGLFrameBuffer *fb);
 	~FGLRenderer() ;
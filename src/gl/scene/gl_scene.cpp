@@ -55,6 +55,7 @@
 #include "r_utility.h"
 #include "a_hexenglobal.h"
 #include "p_local.h"
+#include "m_benchmark.h"
 #include "gl/gl_functions.h"
 #include "gl/system/gl_interface.h"
 #include "gl/system/gl_framebuffer.h"
@@ -1037,6 +1038,7 @@ sector_t * FGLRenderer::RenderViewpoint (AActor * camera, GL_IRECT * bounds, flo
 
 	SetViewMatrix(false, false);
 	mCurrentFoV = fov;
+	if (mainview) mViewFoV = fov;
 
 	// Use the Stereo3D object to set up the viewport and projection matrix
 	Stereo3DMode.render(*this, bounds, fov, ratio, fovratio, toscreen, viewsector, camera->player);
@@ -1110,6 +1112,25 @@ void FGLRenderer::RenderView (player_t* player)
 	// EndDrawScene(viewsector); // moved into Stereo3d logic
 
 	All.Unclock();
+
+	if (benchmarking)
+	{
+		M_BenchStage("all", All.TimeMS());
+		M_BenchStage("bsp", Bsp.TimeMS());
+		M_BenchStage("process", ProcessAll.TimeMS());
+		M_BenchStage("render", RenderAll.TimeMS());
+		M_BenchStage("walls", RenderWall.TimeMS());
+		M_BenchStage("flats", RenderFlat.TimeMS());
+		M_BenchStage("sprites", RenderSprite.TimeMS());
+		M_BenchStage("portals", PortalAll.TimeMS());
+		M_BenchCount("walls", rendered_lines);
+		M_BenchCount("flats", rendered_flats);
+		M_BenchCount("flatprimitives", flatprimitives);
+		M_BenchCount("sprites", rendered_sprites);
+		M_BenchCount("decals", rendered_decals);
+		M_BenchCount("portals", rendered_portals);
+		M_BenchCount("vertices", vertexcount + flatvertices);
+	}
 }
 
 //===========================================================================
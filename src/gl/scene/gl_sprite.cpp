@@ -242,7 +242,18 @@ void GLSprite::Draw(int pass)
 		gl_RenderState.SetFog(0, 0);
 	}
 
-	if (gltexture) gltexture->BindPatch(Colormap.colormap, translation, OverrideShader);
+	float tul = ul, tur = ur, tvt = vt, tvb = vb;
+	if (gltexture)
+	{
+		if (gltexture->BindAtlas(Colormap.colormap, translation, OverrideShader))
+		{
+			tul = gltexture->GetAtlasU(ul);
+			tur = gltexture->GetAtlasU(ur);
+			tvt = gltexture->GetAtlasV(vt);
+			tvb = gltexture->GetAtlasV(vb);
+		}
+		else gltexture->BindPatch(Colormap.colormap, translation, OverrideShader);
+	}
 	else if (!modelframe) gl_RenderState.EnableTexture(false);
 
 	if (!modelframe)
@@ -289,10 +300,10 @@ void GLSprite::Draw(int pass)
 		glBegin(GL_TRIANGLE_STRIP);
 		if (gltexture)
 		{
-			glTexCoord2f(ul, vt); glVertex3fv(&v1[0]);
-			glTexCoord2f(ur, vt); glVertex3fv(&v2[0]);
-			glTexCoord2f(ul, vb); glVertex3fv(&v3[0]);
-			glTexCoord2f(ur, vb); glVertex3fv(&v4[0]);
+			glTexCoord2f(tul, tvt); glVertex3fv(&v1[0]);
+			glTexCoord2f(tur, tvt); glVertex3fv(&v2[0]);
+			glTexCoord2f(tul, tvb); glVertex3fv(&v3[0]);
+			glTexCoord2f(tur, tvb); glVertex3fv(&v4[0]);
 		}
 		else	// Particle
 		{
@@ -316,10 +327,10 @@ void GLSprite::Draw(int pass)
 			glBegin(GL_TRIANGLE_STRIP);
 			if (gltexture)
 			{
-				glTexCoord2f(ul, vt); glVertex3fv(&v1[0]);
-				glTexCoord2f(ur, vt); glVertex3fv(&v2[0]);
-				glTexCoord2f(ul, vb); glVertex3fv(&v3[0]);
-				glTexCoord2f(ur, vb); glVertex3fv(&v4[0]);
+				glTexCoord2f(tul, tvt); glVertex3fv(&v1[0]);
+				glTexCoord2f(tur, tvt); glVertex3fv(&v2[0]);
+				glTexCoord2f(tul, tvb); glVertex3fv(&v3[0]);
+				glTexCoord2f(tur, tvb); glVertex3fv(&v4[0]);
 			}
 			else	// Particle
 			{
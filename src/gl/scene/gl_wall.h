@@ -153,6 +153,7 @@ public:
 private:
 
 	void CheckGlowing();
+	void SetCanvasViewInfo();
 	void PutWall(bool translucent);
 	void CheckTexturePosition();
 
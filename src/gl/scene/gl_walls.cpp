@@ -50,6 +50,7 @@
 
 #include "gl/system/gl_cvars.h"
 #include "gl/renderer/gl_lightdata.h"
+#include "gl/renderer/gl_renderer.h"
 #include "gl/data/gl_data.h"
 #include "gl/dynlights/gl_dynlight.h"
 #include "gl/dynlights/gl_glow.h"
@@ -92,6 +93,33 @@ void GLWall::CheckGlowing()
 }
 
 
+//==========================================================================
+//
+// Tells a camera texture how far away and how wide this wall is
+// so that its updates can be throttled.
+//
+//==========================================================================
+
+void GLWall::SetCanvasViewInfo()
+{
+	float vx = FIXED2FLOAT(viewx);
+	float vy = FIXED2FLOAT(viewy);
+	float dx = glseg.x2 - glseg.x1;
+	float dy = glseg.y2 - glseg.y1;
+	float len2 = dx*dx + dy*dy;
+
+	// closest point on the seg to the viewer
+	float t = len2 > 0 ? ((vx - glseg.x1)*dx + (vy - glseg.y1)*dy) / len2 : 0;
+	t = clamp(t, 0.f, 1.f);
+	float px = glseg.x1 + t*dx - vx;
+	float py = glseg.y1 + t*dy - vy;
+
+	double span = fabs(atan2(glseg.y2 - vy, glseg.x2 - vx) - atan2(glseg.y1 - vy, glseg.x1 - vx));
+	if (span > PI) span = 2*PI - span;
+
+	static_cast<FCanvasTexture*>(gltexture->tex)->SetViewInfo(sqrt(px*px + py*py), span / DEG2RAD(GLRenderer->mViewFoV));
+}
+
 //==========================================================================
 //
 // 
@@ -138,6 +166,11 @@ void GLWall::PutWall(bool translucent)
 
 	CheckGlowing();
 
+	if (gltexture && gltexture->tex->bHasCanvas)
+	{
+		SetCanvasViewInfo();
+	}
+
 	if (translucent) // translucent walls
 	{
 		viewdistance = P_AproxDistance( ((seg->linedef->v1->x+seg->linedef->v2->x)>>1) - viewx,
@@ -56,6 +56,7 @@
 #include "gl/renderer/gl_renderer.h"
 #include "gl/renderer/gl_lightdata.h"
 #include "gl/data/gl_data.h"
+#include "gl/data/gl_vertexbuffer.h"
 #include "gl/textures/gl_hwtexture.h"
 #include "gl/textures/gl_texture.h"
 #include "gl/textures/gl_translate.h"
@@ -230,6 +231,7 @@ void OpenGLFrameBuffer::Swap()
 	}
 	SwapBuffers();
 	Finish.Unclock();
+	if (GLRenderer != NULL && GLRenderer->mStreamBuffer != NULL) GLRenderer->mStreamBuffer->NextFrame();
 	swapped = true;
 	FHardwareTexture::UnbindAll();
 }
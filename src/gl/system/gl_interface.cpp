@@ -172,6 +172,12 @@ void gl_LoadExtensions()
 		gl.flags|=RFL_MAP_BUFFER_RANGE;
 	}
 
+	// Persistent mapping is useless without fences to know when a range may be written again.
+	if (CheckExtension("GL_ARB_buffer_storage") && CheckExtension("GL_ARB_sync"))
+	{
+		gl.flags|=RFL_BUFFER_STORAGE;
+	}
+
 	if (gl.flags & RFL_GL_30)
 	{
 		gl.flags|=RFL_FRAMEBUFFER;
@@ -14,6 +14,7 @@ enum RenderFlags
 	RFL_TEXTUREBUFFER = 256,
 	RFL_NVIDIA = 512,
 	RFL_ATI = 1024,
+	RFL_BUFFER_STORAGE = 2048,
 
 
 	RFL_GL_20 = 0x10000000,
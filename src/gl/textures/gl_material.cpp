@@ -58,12 +58,14 @@
 #include "gl/textures/gl_translate.h"
 #include "gl/textures/gl_bitmap.h"
 #include "gl/textures/gl_material.h"
+#include "gl/textures/gl_spriteatlas.h"
 #include "gl/shaders/gl_shader.h"
 
 EXTERN_CVAR(Bool, gl_render_precise)
 EXTERN_CVAR(Int, gl_lightmode)
 EXTERN_CVAR(Bool, gl_precache)
 EXTERN_CVAR(Bool, gl_texture_usehires)
+EXTERN_CVAR(Bool, gl_spriteatlas)
 
 //===========================================================================
 //
@@ -661,6 +663,8 @@ FMaterial::FMaterial(FTexture * tx, bool forceexpand)
 	SpriteU[0] = SpriteV[0] = 0;
 	spriteright = SpriteU[1] = Width[GLUSE_PATCH] / (float)FHardwareTexture::GetTexDimension(Width[GLUSE_PATCH]);
 	spritebottom = SpriteV[1] = Height[GLUSE_PATCH] / (float)FHardwareTexture::GetTexDimension(Height[GLUSE_PATCH]);
+	mAtlasPage = -1;
+	mAtlasGeneration = 0;
 
 	mTextureLayers.ShrinkToFit();
 	mMaxBound = -1;
@@ -906,6 +910,66 @@ void FMaterial::BindPatch(int cm, int translation, int overrideshader)
 }
 
 
+//===========================================================================
+// 
+//	Copies this sprite into the shared atlas pages
+//
+//===========================================================================
+
+void FMaterial::AddToAtlas()
+{
+	mAtlasGeneration = FSpriteAtlas::Generation;
+	mAtlasPage = -1;
+
+	// Only plain sprites qualify. Anything with a shader, a brightmap or
+	// special filtering needs its own texture.
+	if (tex->UseType != FTexture::TEX_Sprite || !mBaseLayer->bExpand || mShaderIndex != 0 ||
+		tex->bHasCanvas || tex->bWarped || tex->gl_info.bNoFilter)
+	{
+		return;
+	}
+
+	int w, h;
+	unsigned char *buffer = mBaseLayer->CreateTexBuffer(CM_DEFAULT, 0, w, h, true, NULL, 0);
+	tex->ProcessData(buffer, w, h, true);
+
+	// The patch texture coordinates are relative to the size the hardware
+	// texture would have had, so map that size onto the atlas rectangle.
+	if (w == FHardwareTexture::GetTexDimension(w) && h == FHardwareTexture::GetTexDimension(h))
+	{
+		FSpriteAtlas::Insert(buffer, w, h, &mAtlasPage, mAtlasRect);
+	}
+	delete[] buffer;
+}
+
+//===========================================================================
+// 
+//	Binds the atlas page containing this sprite. Returns false if the
+//	sprite can't be drawn from the atlas with the given parameters.
+//
+//===========================================================================
+
+bool FMaterial::BindAtlas(int cm, int translation, int overrideshader)
+{
+	if (!gl_spriteatlas || translation != 0 || overrideshader > 0 || mShaderIndex != 0) return false;
+	if (mAtlasGeneration != FSpriteAtlas::Generation) AddToAtlas();
+	if (mAtlasPage < 0) return false;
+
+	// Colormaps that aren't done by the shader require a separate texture.
+	if (cm != CM_DEFAULT) return false;
+
+	int shaderindex = 0;
+	gl_RenderState.SetupShader(false, shaderindex, cm, 0);
+
+	FSpriteAtlas::Bind(mAtlasPage);
+	for(int i=1; i<=mMaxBound;i++)
+	{
+		FHardwareTexture::Unbind(i);
+		mMaxBound = 0;
+	}
+	return true;
+}
+
 //===========================================================================
 //
 //
@@ -915,7 +979,7 @@ void FMaterial::Precache()
 {
 	if (tex->UseType==FTexture::TEX_Sprite) 
 	{
-		BindPatch(CM_DEFAULT, 0);
+		if (!BindAtlas(CM_DEFAULT, 0)) BindPatch(CM_DEFAULT, 0);
 	}
 	else 
 	{
@@ -1068,6 +1132,7 @@ FMaterial * FMaterial::ValidateTexture(FTextureID no, bool translate)
 
 void FMaterial::FlushAll()
 {
+	FSpriteAtlas::Flush();
 	for(int i=mMaterials.Size()-1;i>=0;i--)
 	{
 		mMaterials[i]->Clean(true);
@@ -120,9 +120,14 @@ class FMaterial
 	float SpriteU[2], SpriteV[2];
 	float spriteright, spritebottom;
 
+	int mAtlasPage;
+	unsigned mAtlasGeneration;
+	float mAtlasRect[4];
+
 	void SetupShader(int shaderindex, int &cm);
 	FGLTexture * ValidateSysTexture(FTexture * tex, bool expand);
 	bool TrimBorders(int *rect);
+	void AddToAtlas();
 
 public:
 	FTexture *tex;
@@ -137,6 +142,7 @@ public:
 
 	void Bind(int cm, int clamp = 0, int translation = 0, int overrideshader = 0);
 	void BindPatch(int cm, int translation = 0, int overrideshader = 0);
+	bool BindAtlas(int cm, int translation = 0, int overrideshader = 0);
 
 	unsigned char * CreateTexBuffer(int cm, int translation, int & w, int & h, bool expand = false, bool allowhires=true) const
 	{
@@ -224,6 +230,10 @@ public:
 	float GetSpriteUR() const { return SpriteU[1]; }
 	float GetSpriteVB() const { return SpriteV[1]; }
 
+	// Maps patch texture coordinates into the atlas page after BindAtlas succeeded
+	float GetAtlasU(float u) const { return mAtlasRect[0] + u * mAtlasRect[2]; }
+	float GetAtlasV(float v) const { return mAtlasRect[1] + v * mAtlasRect[3]; }
+
 
 
 	bool GetTransparent() const
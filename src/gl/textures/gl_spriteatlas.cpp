@@ -0,0 +1,185 @@
+/*
+** gl_spriteatlas.cpp
+** Packs sprite frames into shared texture pages
+**
+**---------------------------------------------------------------------------
+**
+** Untranslated sprite frames are copied into a few large texture pages
+** instead of getting a texture each. Since all sprites are drawn in depth
+** order this is the only way to avoid rebinding a texture for nearly
+** every sprite in a crowded scene.
+**
+*/
+
+#include "gl/system/gl_system.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "v_palette.h"
+
+#include "gl/system/gl_interface.h"
+#include "gl/renderer/gl_renderer.h"
+#include "gl/renderer/gl_colormap.h"
+#include "gl/system/gl_framebuffer.h"
+#include "gl/textures/gl_hwtexture.h"
+#include "gl/textures/gl_spriteatlas.h"
+
+//===========================================================================
+//
+// Sprites are only packed if they are small compared to a page so that
+// a few huge frames cannot use up the space. The page count is capped;
+// anything that doesn't fit falls back to its own patch texture.
+//
+// Pages are mipmapped, but only down to ATLAS_MIPLEVELS. Every sprite
+// gets a transparent border of ATLAS_BORDER pixels on all sides and
+// starts on a multiple of it, so even the smallest level's texels and
+// their filtering neighbours never reach into the next sprite.
+//
+// Sprites are added when they are first drawn, so the smaller levels are
+// not rebuilt for each one. A page that got new sprites is regenerated
+// when it is bound, but no more than once per frame. Sprites added after
+// that are only shown at full size until the next frame.
+//
+//===========================================================================
+
+enum
+{
+	ATLAS_MAXPAGESIZE = 2048,
+	ATLAS_MAXPAGES = 4,
+	ATLAS_MIPLEVELS = 2,
+	ATLAS_BORDER = 1 << ATLAS_MIPLEVELS,
+};
+
+CUSTOM_CVAR(Bool, gl_spriteatlas, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	if (GLRenderer != NULL) FSpriteAtlas::Flush();
+}
+
+TArray<FSpriteAtlas::Page> FSpriteAtlas::Pages;
+int FSpriteAtlas::PageSize;
+unsigned FSpriteAtlas::Generation = 1;
+
+//===========================================================================
+//
+// Simple shelf packer. Sprites are packed left to right into rows whose
+// height is set by the first sprite placed in them.
+//
+//===========================================================================
+
+bool FSpriteAtlas::InsertIntoPage(Page &page, int w, int h, int *x, int *y)
+{
+	if (page.shelfx + w > PageSize)
+	{
+		page.shelfy += page.shelfheight;
+		page.shelfx = 0;
+		page.shelfheight = 0;
+	}
+	if (page.shelfy + h > PageSize) return false;
+
+	*x = page.shelfx;
+	*y = page.shelfy;
+	page.shelfx += w;
+	if (h > page.shelfheight) page.shelfheight = h;
+	return true;
+}
+
+//===========================================================================
+//
+// Uploads a sprite image into the atlas and returns the page and the
+// texture coordinate rectangle it occupies (left, top, width, height).
+//
+//===========================================================================
+
+bool FSpriteAtlas::Insert(unsigned char *buffer, int w, int h, int *page, float *rect)
+{
+	if (PageSize == 0)
+	{
+		PageSize = FHardwareTexture::GetTexDimension(ATLAS_MAXPAGESIZE);
+	}
+
+	int aw = ((w + ATLAS_BORDER - 1) & ~(ATLAS_BORDER - 1)) + 2*ATLAS_BORDER;
+	int ah = ((h + ATLAS_BORDER - 1) & ~(ATLAS_BORDER - 1)) + 2*ATLAS_BORDER;
+	if (aw > PageSize / 8 || ah > PageSize / 8) return false;
+
+	int x, y;
+	unsigned i;
+
+	for (i = 0; i < Pages.Size(); i++)
+	{
+		if (InsertIntoPage(Pages[i], aw, ah, &x, &y)) break;
+	}
+	if (i == Pages.Size())
+	{
+		if (Pages.Size() >= ATLAS_MAXPAGES) return false;
+
+		Page newpage = { new FHardwareTexture(PageSize, PageSize, true, false, false, true), 0, 0, 0, false, -1 };
+
+		// The empty page is cleared to transparent black so that the borders
+		// between the sprites don't bleed when filtered. A NULL buffer would
+		// turn mipmapping off, so pass a cleared one instead. Automatic
+		// mipmap generation is turned off after the clear levels have been
+		// made; Bind does it instead.
+		unsigned char *clear = (unsigned char *)calloc(4, PageSize * (PageSize + 1));
+		bool created = clear != NULL && newpage.tex->CreateTexture(clear, PageSize, PageSize, false, 0, CM_DEFAULT);
+		free(clear);
+		if (!created)
+		{
+			delete newpage.tex;
+			return false;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MIPLEVELS);
+		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, false);
+		Pages.Push(newpage);
+		InsertIntoPage(Pages[i], aw, ah, &x, &y);
+	}
+
+	x += ATLAS_BORDER;
+	y += ATLAS_BORDER;
+	Pages[i].tex->Bind(0, CM_DEFAULT);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+	Pages[i].dirty = true;
+
+	*page = i;
+	rect[0] = x / (float)PageSize;
+	rect[1] = y / (float)PageSize;
+	rect[2] = w / (float)PageSize;
+	rect[3] = h / (float)PageSize;
+	return true;
+}
+
+//===========================================================================
+//
+//
+//
+//===========================================================================
+
+void FSpriteAtlas::Bind(int page)
+{
+	Page &p = Pages[page];
+
+	p.tex->Bind(0, CM_DEFAULT);
+	if (p.dirty && p.mipframe != gl_frameCount)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+		p.dirty = false;
+		p.mipframe = gl_frameCount;
+	}
+}
+
+//===========================================================================
+//
+// Deletes all pages. Materials notice the changed generation and
+// reinsert themselves the next time they are drawn.
+//
+//===========================================================================
+
+void FSpriteAtlas::Flush()
+{
+	for (unsigned i = 0; i < Pages.Size(); i++)
+	{
+		delete Pages[i].tex;
+	}
+	Pages.Clear();
+	PageSize = 0;
+	Generation++;
+}
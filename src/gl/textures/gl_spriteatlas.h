@@ -0,0 +1,40 @@
+#ifndef __GL_SPRITEATLAS_H
+#define __GL_SPRITEATLAS_H
+
+#include "tarray.h"
+
+class FHardwareTexture;
+
+//===========================================================================
+//
+// Shared texture pages for untranslated sprite frames.
+// Packing many small sprites into a few large textures lets consecutive
+// sprites in the depth sorted translucent list share one texture binding.
+//
+//===========================================================================
+
+class FSpriteAtlas
+{
+	struct Page
+	{
+		FHardwareTexture *tex;
+		int shelfx, shelfy, shelfheight;
+		bool dirty;			// sprites were added since the mipmaps were made
+		long mipframe;		// frame the mipmaps were last made in
+	};
+
+	static TArray<Page> Pages;
+	static int PageSize;
+
+	static bool InsertIntoPage(Page &page, int w, int h, int *x, int *y);
+
+public:
+	static unsigned Generation;
+
+	static bool Insert(unsigned char *buffer, int w, int h, int *page, float *rect);
+	static void Bind(int page);
+	static void Flush();
+	static int NumPages() { return Pages.Size(); }
+};
+
+#endif
@@ -50,11 +50,12 @@ inline long long GetClockCycle ()
 }
 #endif
 
-#if defined (__APPLE__)
+#if defined (__APPLE__) || defined (__unix__)
 
+// GetClockCycle is not calibrated here, so use the regular timer instead.
 typedef cycle_t glcycle_t;
 
-#else // !__APPLE__
+#else // !__APPLE__ && !__unix__
 
 class glcycle_t
 {
@@ -99,7 +100,7 @@ private:
 	long long Counter;
 };
 
-#endif // __APPLE__
+#endif // __APPLE__ || __unix__
 
 extern glcycle_t RenderWall,SetupWall,ClipWall,SplitWall;
 extern glcycle_t RenderFlat,SetupFlat;
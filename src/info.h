@@ -60,6 +60,8 @@ enum
 	SPR_NOCHANGE,	// Do not change sprite (frame change is okay)
 };
 
+extern bool ThinkProfiling;
+
 struct FState
 {
 	FState		*NextState;
@@ -141,7 +143,14 @@ struct FState
 	{
 		if (ActionFunc != NULL)
 		{
-			ActionFunc(self, stateowner, this, ParameterIndex-1, statecall);
+			if (ThinkProfiling)
+			{
+				CallProfiledAction(self, stateowner, statecall);
+			}
+			else
+			{
+				ActionFunc(self, stateowner, this, ParameterIndex-1, statecall);
+			}
 			return true;
 		}
 		else
@@ -149,6 +158,7 @@ struct FState
 			return false;
 		}
 	}
+	void CallProfiledAction(AActor *self, AActor *stateowner, StateCallData *statecall);
 	static const PClass *StaticFindStateOwner (const FState *state);
 	static const PClass *StaticFindStateOwner (const FState *state, const FActorInfo *info);
 	static FRandom pr_statetics;
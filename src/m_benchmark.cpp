@@ -0,0 +1,241 @@
+/*
+** m_benchmark.cpp
+** Machine readable frame statistics for -timedemo runs
+**
+**---------------------------------------------------------------------------
+**
+** Each frame the time since the previous frame is recorded, and renderers
+** add their own stage timings and primitive counts. When the demo ends the
+** whole lot is written to the report file as JSON so that it can be
+** compared by scripts between builds.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "tarray.h"
+#include "zstring.h"
+#include "stats.h"
+#include "version.h"
+#include "m_benchmark.h"
+
+bool benchmarking;
+
+struct FBenchValue
+{
+	const char *Name;
+	double Total;
+	double Max;
+};
+
+static FString ReportFile;
+static TArray<double> FrameTimes;
+static TArray<FBenchValue> Stages;
+static TArray<FBenchValue> Counts;
+static cycle_t FrameClock;
+static bool FrameClockRunning;
+
+//==========================================================================
+//
+// M_BenchStart
+//
+//==========================================================================
+
+void M_BenchStart (const char *reportfile)
+{
+	ReportFile = reportfile;
+	FrameTimes.Clear();
+	Stages.Clear();
+	Counts.Clear();
+	FrameClockRunning = false;
+	benchmarking = true;
+}
+
+//==========================================================================
+//
+// Accumulates one value under the given name. Names are expected to be
+// string literals so the pointer compare nearly always hits.
+//
+//==========================================================================
+
+static void AddValue (TArray<FBenchValue> &values, const char *name, double value)
+{
+	unsigned i;
+
+	for (i = 0; i < values.Size(); ++i)
+	{
+		if (values[i].Name == name || strcmp(values[i].Name, name) == 0)
+		{
+			break;
+		}
+	}
+	if (i == values.Size())
+	{
+		FBenchValue newval = { name, 0, 0 };
+		values.Push(newval);
+	}
+	values[i].Total += value;
+	if (value > values[i].Max) values[i].Max = value;
+}
+
+// Values reported before the first frame ended have no frame time to
+// go with them, so they are dropped.
+
+void M_BenchStage (const char *name, double ms)
+{
+	if (FrameClockRunning) AddValue (Stages, name, ms);
+}
+
+void M_BenchCount (const char *name, int count)
+{
+	if (FrameClockRunning) AddValue (Counts, name, count);
+}
+
+//==========================================================================
+//
+// M_BenchFrame
+//
+// Called once at the end of every displayed frame. The frame time is the
+// time between two consecutive calls, so it includes the game tic as well.
+//
+//==========================================================================
+
+void M_BenchFrame (double displayms)
+{
+	if (FrameClockRunning)
+	{
+		FrameClock.Unclock();
+		FrameTimes.Push(FrameClock.TimeMS());
+		M_BenchStage ("display", displayms);
+	}
+	FrameClock.Reset();
+	FrameClock.Clock();
+	FrameClockRunning = true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+static int CompareDoubles (const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static double Percentile (const TArray<double> &sorted, int pct)
+{
+	if (sorted.Size() == 0) return 0;
+	unsigned index = (sorted.Size() - 1) * pct / 100;
+	return sorted[index];
+}
+
+//==========================================================================
+//
+// M_EscapeJSON
+//
+// Returns the string with everything that may not appear inside a JSON
+// string literal escaped.
+//
+//==========================================================================
+
+FString M_EscapeJSON (const char *str)
+{
+	FString out;
+
+	for (; *str != 0; ++str)
+	{
+		unsigned char c = *str;
+
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += (char)c;
+		}
+		else if (c < 0x20)
+		{
+			out.AppendFormat ("\\u%04x", c);
+		}
+		else
+		{
+			out += (char)c;
+		}
+	}
+	return out;
+}
+
+static void WriteValues (FILE *f, const char *section, const TArray<FBenchValue> &values, unsigned frames)
+{
+	fprintf (f, "  \"%s\": {\n", section);
+	for (unsigned i = 0; i < values.Size(); ++i)
+	{
+		fprintf (f, "    \"%s\": { \"avg\": %.4f, \"max\": %.4f }%s\n", M_EscapeJSON(values[i].Name).GetChars(),
+			frames > 0 ? values[i].Total / frames : 0., values[i].Max, i + 1 < values.Size() ? "," : "");
+	}
+	fprintf (f, "  }");
+}
+
+//==========================================================================
+//
+// M_BenchWriteReport
+//
+// Returns false if the report could not be written.
+//
+//==========================================================================
+
+bool M_BenchWriteReport (const char *demoname, int gametics, int realtics)
+{
+	if (!benchmarking)
+	{
+		return true;
+	}
+	benchmarking = false;
+
+	FILE *f = fopen (ReportFile, "w");
+	if (f == NULL)
+	{
+		Printf ("Could not write benchmark report %s\n", ReportFile.GetChars());
+		return false;
+	}
+
+	TArray<double> sorted = FrameTimes;
+	unsigned frames = sorted.Size();
+	double total = 0;
+
+	if (frames > 0)
+	{
+		qsort (&sorted[0], frames, sizeof(double), CompareDoubles);
+	}
+	for (unsigned i = 0; i < frames; ++i)
+	{
+		total += sorted[i];
+	}
+
+	fprintf (f, "{\n");
+	fprintf (f, "  \"version\": \"%s\",\n", M_EscapeJSON(GetVersionString()).GetChars());
+	fprintf (f, "  \"demo\": \"%s\",\n", M_EscapeJSON(demoname).GetChars());
+	fprintf (f, "  \"gametics\": %d,\n", gametics);
+	fprintf (f, "  \"realtics\": %d,\n", realtics);
+	fprintf (f, "  \"frames\": %u,\n", frames);
+	fprintf (f, "  \"frametime\": { \"avg\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		frames > 0 ? total / frames : 0., frames > 0 ? sorted[0] : 0., Percentile(sorted, 50), Percentile(sorted, 90),
+		Percentile(sorted, 95), Percentile(sorted, 99), frames > 0 ? sorted[frames - 1] : 0.);
+	WriteValues (f, "stages", Stages, frames);
+	fprintf (f, ",\n");
+	WriteValues (f, "counts", Counts, frames);
+	fprintf (f, "\n}\n");
+
+	bool ok = !ferror (f);
+	if (fclose (f) != 0 || !ok)
+	{
+		Printf ("Could not write benchmark report %s\n", ReportFile.GetChars());
+		return false;
+	}
+	Printf ("Benchmark report written to %s\n", ReportFile.GetChars());
+	return true;
+}
@@ -0,0 +1,19 @@
+#ifndef __M_BENCHMARK_H__
+#define __M_BENCHMARK_H__
+
+// Frame statistics collected during a -timedemo run started with
+// -benchreport <file>. Renderers feed their per-frame timings and
+// counts through M_BenchStage/M_BenchCount when benchmarking is set.
+
+extern bool benchmarking;
+
+void M_BenchStart (const char *reportfile);
+void M_BenchFrame (double displayms);
+void M_BenchStage (const char *name, double ms);
+void M_BenchCount (const char *name, int count);
+bool M_BenchWriteReport (const char *demoname, int gametics, int realtics);
+
+class FString;
+FString M_EscapeJSON (const char *str);
+
+#endif
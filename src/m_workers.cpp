@@ -0,0 +1,287 @@
+/*
+** m_workers.cpp
+** Worker threads for splitting up per-frame work
+**
+**---------------------------------------------------------------------------
+**
+** The pool is created on first use and grows to the largest thread count
+** ever requested. Jobs are handed out one at a time from a shared counter
+** so uneven jobs still balance. The thread that calls M_RunParallel works
+** on the jobs as well and only returns once all of them are done.
+**
+*/
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include <stdint.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_workers.h"
+
+enum { MAX_WORKERS = 31 };
+
+static int NumWorkers;
+static bool QuitWorkers;
+
+static unsigned JobGeneration;
+static WorkerFunc JobFunc;
+static void *JobData;
+static int JobCount;
+static int NextJob;
+static int JobsDone;
+static int JobThreads;
+
+#ifdef _WIN32
+static HANDLE Workers[MAX_WORKERS];
+static HANDLE WorkSemaphore;
+static HANDLE DoneEvent;
+static CRITICAL_SECTION WorkLock;
+
+static inline void LockJobs() { EnterCriticalSection(&WorkLock); }
+static inline void UnlockJobs() { LeaveCriticalSection(&WorkLock); }
+#else
+static pthread_t Workers[MAX_WORKERS];
+static pthread_mutex_t WorkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WorkCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DoneCond = PTHREAD_COND_INITIALIZER;
+
+static inline void LockJobs() { pthread_mutex_lock(&WorkLock); }
+static inline void UnlockJobs() { pthread_mutex_unlock(&WorkLock); }
+#endif
+
+//==========================================================================
+//
+// M_GetCPUCount
+//
+//==========================================================================
+
+int M_GetCPUCount ()
+{
+	int count;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	count = info.dwNumberOfProcessors;
+#else
+	count = (int)sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+	return count < 1 ? 1 : count > MAX_WORKERS + 1 ? MAX_WORKERS + 1 : count;
+}
+
+//==========================================================================
+//
+// Takes jobs until none are left. Must be called with the lock held.
+// Returns true if this call finished the last job.
+//
+//==========================================================================
+
+static bool RunJobs ()
+{
+	bool finished = false;
+	while (NextJob < JobCount)
+	{
+		int job = NextJob++;
+		WorkerFunc func = JobFunc;
+		void *data = JobData;
+
+		UnlockJobs ();
+		func (job, data);
+		LockJobs ();
+
+		if (++JobsDone == JobCount)
+		{
+			finished = true;
+		}
+	}
+	return finished;
+}
+
+//==========================================================================
+//
+// WorkerThread
+//
+// Workers whose index is beyond the thread count of the current job
+// sit it out so that a smaller count can be requested after a larger one.
+//
+//==========================================================================
+
+#ifdef _WIN32
+static DWORD WINAPI WorkerThread (LPVOID arg)
+{
+	int id = (int)(intptr_t)arg;
+
+	for (;;)
+	{
+		WaitForSingleObject (WorkSemaphore, INFINITE);
+		LockJobs ();
+		if (QuitWorkers)
+		{
+			UnlockJobs ();
+			break;
+		}
+		if (id < JobThreads - 1 && RunJobs ())
+		{
+			SetEvent (DoneEvent);
+		}
+		UnlockJobs ();
+	}
+	return 0;
+}
+#else
+static void *WorkerThread (void *arg)
+{
+	int id = (int)(intptr_t)arg;
+	unsigned seen = 0;
+
+	LockJobs ();
+	for (;;)
+	{
+		while (!QuitWorkers && seen == JobGeneration)
+		{
+			pthread_cond_wait (&WorkCond, &WorkLock);
+		}
+		if (QuitWorkers)
+		{
+			break;
+		}
+		seen = JobGeneration;
+		if (id < JobThreads - 1 && RunJobs ())
+		{
+			pthread_cond_signal (&DoneCond);
+		}
+	}
+	UnlockJobs ();
+	return NULL;
+}
+#endif
+
+//==========================================================================
+//
+// StartWorkers
+//
+//==========================================================================
+
+static void StartWorkers (int count)
+{
+	if (count > MAX_WORKERS)
+	{
+		count = MAX_WORKERS;
+	}
+	if (NumWorkers == 0 && count > 0)
+	{
+#ifdef _WIN32
+		InitializeCriticalSection (&WorkLock);
+		WorkSemaphore = CreateSemaphore (NULL, 0, 0x7fffffff, NULL);
+		DoneEvent = CreateEvent (NULL, FALSE, FALSE, NULL);
+#endif
+		atterm (M_ShutdownWorkers);
+	}
+	while (NumWorkers < count)
+	{
+#ifdef _WIN32
+		Workers[NumWorkers] = CreateThread (NULL, 0, WorkerThread, (LPVOID)(intptr_t)NumWorkers, 0, NULL);
+		if (Workers[NumWorkers] == NULL) break;
+#else
+		if (pthread_create (&Workers[NumWorkers], NULL, WorkerThread, (void *)(intptr_t)NumWorkers) != 0) break;
+#endif
+		NumWorkers++;
+	}
+}
+
+//==========================================================================
+//
+// M_RunParallel
+//
+// Calls func once for every job number in [0, numjobs) using up to
+// numthreads threads, including the calling one.
+//
+//==========================================================================
+
+void M_RunParallel (WorkerFunc func, void *data, int numjobs, int numthreads)
+{
+	if (numthreads > numjobs)
+	{
+		numthreads = numjobs;
+	}
+	if (numthreads > 1 && NumWorkers < numthreads - 1)
+	{
+		StartWorkers (numthreads - 1);
+	}
+	if (numthreads <= 1 || NumWorkers == 0)
+	{
+		for (int i = 0; i < numjobs; ++i)
+		{
+			func (i, data);
+		}
+		return;
+	}
+
+	LockJobs ();
+	JobFunc = func;
+	JobData = data;
+	JobCount = numjobs;
+	NextJob = 0;
+	JobsDone = 0;
+	JobThreads = numthreads;
+	JobGeneration++;
+#ifdef _WIN32
+	UnlockJobs ();
+	ReleaseSemaphore (WorkSemaphore, NumWorkers, NULL);
+	LockJobs ();
+	bool finished = RunJobs ();
+	UnlockJobs ();
+	if (!finished)
+	{
+		WaitForSingleObject (DoneEvent, INFINITE);
+	}
+#else
+	pthread_cond_broadcast (&WorkCond);
+	RunJobs ();
+	while (JobsDone < JobCount)
+	{
+		pthread_cond_wait (&DoneCond, &WorkLock);
+	}
+	UnlockJobs ();
+#endif
+}
+
+//==========================================================================
+//
+// M_ShutdownWorkers
+//
+//==========================================================================
+
+void M_ShutdownWorkers ()
+{
+	if (NumWorkers == 0)
+	{
+		return;
+	}
+	LockJobs ();
+	QuitWorkers = true;
+	UnlockJobs ();
+#ifdef _WIN32
+	ReleaseSemaphore (WorkSemaphore, NumWorkers, NULL);
+	WaitForMultipleObjects (NumWorkers, Workers, TRUE, INFINITE);
+	for (int i = 0; i < NumWorkers; ++i)
+	{
+		CloseHandle (Workers[i]);
+	}
+	CloseHandle (WorkSemaphore);
+	CloseHandle (DoneEvent);
+	DeleteCriticalSection (&WorkLock);
+#else
+	pthread_cond_broadcast (&WorkCond);
+	for (int i = 0; i < NumWorkers; ++i)
+	{
+		pthread_join (Workers[i], NULL);
+	}
+#endif
+	NumWorkers = 0;
+}
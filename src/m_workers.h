@@ -0,0 +1,15 @@
+#ifndef __M_WORKERS_H__
+#define __M_WORKERS_H__
+
+// A small pool of worker threads for splitting frame work into
+// independent jobs. The calling thread always takes part, so a pool of
+// N threads has N-1 workers. Jobs must not touch the playsim or any
+// other shared state that isn't explicitly partitioned between them.
+
+typedef void (*WorkerFunc) (int job, void *data);
+
+int M_GetCPUCount ();
+void M_RunParallel (WorkerFunc func, void *data, int numjobs, int numthreads);
+void M_ShutdownWorkers ();
+
+#endif
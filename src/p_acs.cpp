@@ -3282,7 +3282,8 @@ void DLevelScript::ChangeFlat (int tag, int name, bool floorOrCeiling)
 
 	flat = TexMan.GetTexture (flatname, FTexture::TEX_Flat, FTextureManager::TEXMAN_Overridable);
 
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		int pos = floorOrCeiling? sector_t::ceiling : sector_t::floor;
 		sectors[secnum].SetTexture(pos, flat);
@@ -3313,7 +3314,8 @@ void DLevelScript::SetLineTexture (int lineid, int side, int position, int name)
 
 	texture = TexMan.GetTexture (texname, FTexture::TEX_Wall, FTextureManager::TEXMAN_Overridable);
 
-	while ((linenum = P_FindLineFromID (lineid, linenum)) >= 0)
+	FLineIdIterator itr(lineid);
+	while ((linenum = itr.Next()) >= 0)
 	{
 		side_t *sidedef;
 
@@ -5177,7 +5179,8 @@ int DLevelScript::CallFunction(int argCount, int funcIndex, SDWORD *args, const
 				{
 					int secnum = -1;
 
-					while ((secnum = P_FindSectorFromTag(args[0], secnum)) >= 0)
+					FSectorTagIterator itr(args[0]);
+					while ((secnum = itr.Next()) >= 0)
 					{
 						SN_StartSequence(&sectors[secnum], args[2], seqname, 0);
 					}
@@ -5691,7 +5694,8 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
 			{
 				int line = -1;
 
-				while ((line = P_FindLineFromID(args[0], line)) >= 0)
+				FLineIdIterator itr(args[0]);
+				while ((line = itr.Next()) >= 0)
 				{
 					lines[line].activation = args[1];
 				}
@@ -5931,7 +5935,8 @@ int DLevelScript::RunScript ()
 	{
 		int secnum = -1;
 
-		while ((secnum = P_FindSectorFromTag (statedata, secnum)) >= 0)
+		FSectorTagIterator itr(statedata);
+		while ((secnum = itr.Next()) >= 0)
 			if (sectors[secnum].floordata || sectors[secnum].ceilingdata)
 				return resultValue;
 
@@ -7975,29 +7980,26 @@ scriptwait:
 			{
 				int line = -1;
 
-				while ((line = P_FindLineFromID (STACK(2), line)) >= 0)
+				FLineIdIterator itr(STACK(2));
+				while ((line = itr.Next()) >= 0)
 				{
 					switch (STACK(1))
 					{
 					case BLOCK_NOTHING:
-						lines[line].flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING|ML_RAILING|ML_BLOCK_PLAYERS);
+						P_SetLineFlags (&lines[line], ML_BLOCKING|ML_BLOCKEVERYTHING|ML_RAILING|ML_BLOCK_PLAYERS, 0);
 						break;
 					case BLOCK_CREATURES:
 					default:
-						lines[line].flags &= ~(ML_BLOCKEVERYTHING|ML_RAILING|ML_BLOCK_PLAYERS);
-						lines[line].flags |= ML_BLOCKING;
+						P_SetLineFlags (&lines[line], ML_BLOCKEVERYTHING|ML_RAILING|ML_BLOCK_PLAYERS, ML_BLOCKING);
 						break;
 					case BLOCK_EVERYTHING:
-						lines[line].flags &= ~(ML_RAILING|ML_BLOCK_PLAYERS);
-						lines[line].flags |= ML_BLOCKING|ML_BLOCKEVERYTHING;
+						P_SetLineFlags (&lines[line], ML_RAILING|ML_BLOCK_PLAYERS, ML_BLOCKING|ML_BLOCKEVERYTHING);
 						break;
 					case BLOCK_RAILING:
-						lines[line].flags &= ~(ML_BLOCKEVERYTHING|ML_BLOCK_PLAYERS);
-						lines[line].flags |= ML_RAILING|ML_BLOCKING;
+						P_SetLineFlags (&lines[line], ML_BLOCKEVERYTHING|ML_BLOCK_PLAYERS, ML_RAILING|ML_BLOCKING);
 						break;
 					case BLOCK_PLAYERS:
-						lines[line].flags &= ~(ML_BLOCKEVERYTHING|ML_BLOCKING|ML_RAILING);
-						lines[line].flags |= ML_BLOCK_PLAYERS;
+						P_SetLineFlags (&lines[line], ML_BLOCKEVERYTHING|ML_BLOCKING|ML_RAILING, ML_BLOCK_PLAYERS);
 						break;
 					}
 				}
@@ -8010,7 +8012,8 @@ scriptwait:
 			{
 				int line = -1;
 
-				while ((line = P_FindLineFromID (STACK(2), line)) >= 0)
+				FLineIdIterator itr(STACK(2));
+				while ((line = itr.Next()) >= 0)
 				{
 					if (STACK(1))
 						lines[line].flags |= ML_BLOCKMONSTERS;
@@ -8035,7 +8038,8 @@ scriptwait:
 					arg0 = -FName(FBehavior::StaticLookupString(arg0));
 				}
 
-				while ((linenum = P_FindLineFromID (STACK(7), linenum)) >= 0)
+				FLineIdIterator itr(STACK(7));
+				while ((linenum = itr.Next()) >= 0)
 				{
 					line_t *line = &lines[linenum];
 					line->special = specnum;
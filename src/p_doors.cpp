@@ -485,7 +485,8 @@ bool EV_DoDoor (DDoor::EVlDoor type, line_t *line, AActor *thing,
 	{	// [RH] Remote door
 
 		secnum = -1;
-		while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+		FSectorTagIterator itr(tag);
+		while ((secnum = itr.Next()) >= 0)
 		{
 			sec = &sectors[secnum];
 			// if the ceiling is already moving, don't start the door action
@@ -812,7 +813,8 @@ bool EV_SlidingDoor (line_t *line, AActor *actor, int tag, int speed, int delay)
 		return false;
 	}
 
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sec = &sectors[secnum];
 		if (sec->ceilingdata != NULL)
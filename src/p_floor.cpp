@@ -547,7 +547,8 @@ bool EV_FloorCrushStop (int tag)
 {
 	int secnum = -1;
 
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = sectors + secnum;
 
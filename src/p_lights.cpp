@@ -191,7 +191,8 @@ void EV_StartLightFlickering (int tag, int upper, int lower)
 	int secnum;
 		
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		new DFlicker (&sectors[secnum], upper, lower);
 	}
@@ -361,7 +362,8 @@ void EV_StartLightStrobing (int tag, int upper, int lower, int utics, int ltics)
 	int secnum;
 		
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = &sectors[secnum];
 		if (sec->lightingdata)
@@ -376,7 +378,8 @@ void EV_StartLightStrobing (int tag, int utics, int ltics)
 	int secnum;
 		
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = &sectors[secnum];
 		if (sec->lightingdata)
@@ -400,7 +403,7 @@ void EV_TurnTagLightsOff (int tag)
 	int secnum;
 
 	// [RH] Don't do a linear search
-	for (secnum = -1; (secnum = P_FindSectorFromTag (tag, secnum)) >= 0; ) 
+	for (FSectorTagIterator itr(tag); (secnum = itr.Next()) >= 0; ) 
 	{
 		sector_t *sector = sectors + secnum;
 		int min = sector->lightlevel;
@@ -486,7 +489,8 @@ void EV_LightTurnOnPartway (int tag, fixed_t frac)
 
 	// Search all sectors for ones with same tag as activating line
 	i = -1;
-	while ((i = P_FindSectorFromTag (tag, i)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((i = itr.Next()) >= 0)
 	{
 		sector_t *temp, *sector = sectors + i;
 		int j, bright = 0, min = sector->lightlevel;
@@ -522,7 +526,8 @@ void EV_LightChange (int tag, int value)
 {
 	int secnum = -1;
 
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetLightLevel(sectors[secnum].lightlevel + value);
 	}
@@ -682,7 +687,8 @@ void EV_StartLightGlowing (int tag, int upper, int lower, int tics)
 	}
 
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = &sectors[secnum];
 		if (sec->lightingdata)
@@ -703,7 +709,8 @@ void EV_StartLightFading (int tag, int value, int tics)
 	int secnum;
 
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag,secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = &sectors[secnum];
 		if (sec->lightingdata)
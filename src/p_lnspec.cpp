@@ -1916,7 +1916,8 @@ FUNC(LS_Sector_ChangeSound)
 
 	secNum = -1;
 	rtn = false;
-	while ((secNum = P_FindSectorFromTag (arg0,	secNum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secNum = itr.Next()) >= 0)
 	{
 		sectors[secNum].seqType = arg1;
 		rtn = true;
@@ -1935,7 +1936,8 @@ FUNC(LS_Sector_ChangeFlags)
 
 	secNum = -1;
 	rtn = false;
-	while ((secNum = P_FindSectorFromTag (arg0,	secNum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secNum = itr.Next()) >= 0)
 	{
 		sectors[secNum].Flags = (sectors[secNum].Flags | arg1) & ~arg2;
 		rtn = true;
@@ -2022,7 +2024,8 @@ FUNC(LS_Sector_SetTranslucent)
 	{
 		int secnum = -1;
 
-		while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+		FSectorTagIterator itr(arg0);
+		while ((secnum = itr.Next()) >= 0)
 		{
 			sectors[secnum].SetAlpha(arg1, Scale(arg2, OPAQUE, 255));
 			sectors[secnum].ChangeFlags(arg1, ~PLANEF_ADDITIVE, arg3? PLANEF_ADDITIVE:0);
@@ -2181,7 +2184,7 @@ static void SetScroller (int tag, DScroller::EScrollType type, fixed_t dx, fixed
 	}
 
 	// Need to create scrollers for the sector(s)
-	for (i = -1; (i = P_FindSectorFromTag (tag, i)) >= 0; )
+	for (FSectorTagIterator itr(tag); (i = itr.Next()) >= 0; )
 	{
 		new DScroller (type, dx, dy, -1, i, 0);
 	}
@@ -2241,7 +2244,8 @@ FUNC(LS_Sector_SetDamage)
 	// Since it doesn't really matter whether the type is translated
 	// here or in P_PlayerInSpecialSector I think it's the best solution.
 	int secnum = -1;
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0) {
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0) {
 		sectors[secnum].damage = arg1;
 		sectors[secnum].mod = arg2;
 	}
@@ -2258,7 +2262,8 @@ FUNC(LS_Sector_SetGravity)
 		arg2 = 99;
 	gravity = (float)arg1 + (float)arg2 * 0.01f;
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 		sectors[secnum].gravity = gravity;
 
 	return true;
@@ -2269,7 +2274,8 @@ FUNC(LS_Sector_SetColor)
 {
 	int secnum = -1;
 	
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetColor(arg1, arg2, arg3, arg4);
 	}
@@ -2282,7 +2288,8 @@ FUNC(LS_Sector_SetFade)
 {
 	int secnum = -1;
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetFade(arg1, arg2, arg3);
 	}
@@ -2296,7 +2303,8 @@ FUNC(LS_Sector_SetCeilingPanning)
 	fixed_t xofs = arg1 * FRACUNIT + arg2 * (FRACUNIT/100);
 	fixed_t yofs = arg3 * FRACUNIT + arg4 * (FRACUNIT/100);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetXOffset(sector_t::ceiling, xofs);
 		sectors[secnum].SetYOffset(sector_t::ceiling, yofs);
@@ -2311,7 +2319,8 @@ FUNC(LS_Sector_SetFloorPanning)
 	fixed_t xofs = arg1 * FRACUNIT + arg2 * (FRACUNIT/100);
 	fixed_t yofs = arg3 * FRACUNIT + arg4 * (FRACUNIT/100);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetXOffset(sector_t::floor, xofs);
 		sectors[secnum].SetYOffset(sector_t::floor, yofs);
@@ -2331,7 +2340,8 @@ FUNC(LS_Sector_SetFloorScale)
 	if (yscale)
 		yscale = FixedDiv (FRACUNIT, yscale);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		if (xscale)
 			sectors[secnum].SetXScale(sector_t::floor, xscale);
@@ -2353,7 +2363,8 @@ FUNC(LS_Sector_SetCeilingScale)
 	if (yscale)
 		yscale = FixedDiv (FRACUNIT, yscale);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		if (xscale)
 			sectors[secnum].SetXScale(sector_t::ceiling, xscale);
@@ -2373,7 +2384,8 @@ FUNC(LS_Sector_SetFloorScale2)
 	if (arg2)
 		arg2 = FixedDiv (FRACUNIT, arg2);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		if (arg1)
 			sectors[secnum].SetXScale(sector_t::floor, arg1);
@@ -2393,7 +2405,8 @@ FUNC(LS_Sector_SetCeilingScale2)
 	if (arg2)
 		arg2 = FixedDiv (FRACUNIT, arg2);
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		if (arg1)
 			sectors[secnum].SetXScale(sector_t::ceiling, arg1);
@@ -2410,7 +2423,8 @@ FUNC(LS_Sector_SetRotation)
 	angle_t ceiling = arg2 * ANGLE_1;
 	angle_t floor = arg1 * ANGLE_1;
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sectors[secnum].SetAngle(sector_t::floor, floor);
 		sectors[secnum].SetAngle(sector_t::ceiling, ceiling);
@@ -2580,7 +2594,7 @@ FUNC(LS_Line_SetBlocking)
 
 	for(int line = -1; (line = P_FindLineFromID (arg0, line)) >= 0; )
 	{
-		lines[line].flags = (lines[line].flags & ~clearflags) | setflags;
+		P_SetLineFlags (&lines[line], clearflags, setflags);
 	}
 	return true;
 }
@@ -2870,7 +2884,8 @@ FUNC(LS_TranslucentLine)
 // TranslucentLine (id, amount, type)
 {
 	int linenum = -1;
-	while ((linenum = P_FindLineFromID (arg0, linenum)) >= 0)
+	FLineIdIterator itr(arg0);
+	while ((linenum = itr.Next()) >= 0)
 	{
 		lines[linenum].Alpha = Scale(clamp(arg1, 0, 255), FRACUNIT, 255);
 		if (arg2 == 0)
@@ -2998,7 +3013,8 @@ FUNC(LS_ClearForceField)
 	int secnum = -1;
 	bool rtn = false;
 
-	while ((secnum = P_FindSectorFromTag (arg0, secnum)) >= 0)
+	FSectorTagIterator itr(arg0);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		sector_t *sec = &sectors[secnum];
 		rtn = true;
@@ -3008,7 +3024,7 @@ FUNC(LS_ClearForceField)
 			line_t *line = sec->lines[i];
 			if (line->backsector != NULL && line->special == ForceField)
 			{
-				line->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
+				P_SetLineFlags (line, ML_BLOCKING|ML_BLOCKEVERYTHING, 0);
 				line->special = 0;
 				line->sidedef[0]->SetTexture(side_t::mid, FNullTextureID());
 				line->sidedef[1]->SetTexture(side_t::mid, FNullTextureID());
@@ -3024,7 +3040,7 @@ FUNC(LS_GlassBreak)
 	bool switched;
 	bool quest1, quest2;
 
-	ln->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
+	P_SetLineFlags (ln, ML_BLOCKING|ML_BLOCKEVERYTHING, 0);
 	switched = P_ChangeSwitchTexture (ln->sidedef[0], false, 0, &quest1);
 	ln->special = 0;
 	if (ln->sidedef[1] != NULL)
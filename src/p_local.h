@@ -200,6 +200,8 @@ struct intercept_t
 
 typedef bool (*traverser_t) (intercept_t *in);
 
+void P_SortIntercepts (intercept_t *in, unsigned count);
+
 fixed_t P_AproxDistance (fixed_t dx, fixed_t dy);
 
 //==========================================================================
@@ -291,8 +293,20 @@ class FBlockThingsIterator
 
 	int curx, cury;
 
-	FBlockNode *block;
+	int block;			// index into blockactors, or -1
+	int cursor;			// next entry of the block to check, counting down
+
+	// Iterators whose block may be compacted while they are in use
+	FBlockThingsIterator *NextActive;
+	FBlockThingsIterator **PrevActive;
+	static FBlockThingsIterator *Active;
 
+	// Only the path traverser, which visits blocks one at a time, needs
+	// the hash to decide what to return. Rectangle queries can tell from
+	// an actor's origin block, unless an actor has been relinked since
+	// the query started.
+	bool UseHash;
+	unsigned LinkStamp;
 	int Buckets[32];
 
 	struct HashEntry
@@ -309,18 +323,27 @@ class FBlockThingsIterator
 	void StartBlock(int x, int y);
 	void SwitchBlock(int x, int y);
 	void ClearHash();
+	bool AddToHash(AActor *me);
+	void Register();
 
 	// The following is only for use in the path traverser 
 	// and therefore declared private.
 	FBlockThingsIterator();
 
+	// Not copyable, since it is registered by address.
+	FBlockThingsIterator(const FBlockThingsIterator &);
+	FBlockThingsIterator &operator=(const FBlockThingsIterator &);
+
 	friend class FPathTraverse;
 
 public:
 	FBlockThingsIterator(int minx, int miny, int maxx, int maxy);
 	FBlockThingsIterator(const FBoundingBox &box);
+	~FBlockThingsIterator();
 	AActor *Next(bool centeronly = false);
-	void Reset() { StartBlock(minx, miny); }
+	void Reset();
+
+	static void CompactBlock(int block);
 };
 
 class FPathTraverse
@@ -329,7 +352,7 @@ class FPathTraverse
 
 	divline_t trace;
 	unsigned int intercept_index;
-	unsigned int intercept_count;
+	unsigned int intercept_pos;
 	fixed_t maxfrac;
 	unsigned int count;
 
@@ -420,6 +443,9 @@ void	P_SlideMove (AActor* mo, fixed_t tryx, fixed_t tryy, int numsteps);
 bool	P_BounceWall (AActor *mo);
 bool	P_BounceActor (AActor *mo, AActor *BlockingMobj, bool ontop);
 bool	P_CheckSight (const AActor *t1, const AActor *t2, int flags=0);
+void	P_InvalidateSightCache ();
+void	P_SetLineFlags (line_t *line, DWORD clear, DWORD set);
+void	P_PrefetchSightChecks ();
 
 enum ESightFlags
 {
@@ -504,6 +530,7 @@ void	P_RadiusAttack (AActor *spot, AActor *source, int damage, int distance,
 void	P_DelSector_List();
 void	P_DelSeclist(msecnode_t *);							// phares 3/16/98
 msecnode_t*	P_DelSecnode(msecnode_t *);
+void	P_FreeSecnodes();
 void	P_CreateSecNodeList(AActor*,fixed_t,fixed_t);		// phares 3/14/98
 int		P_GetMoveFactor(const AActor *mo, int *frictionp);	// phares  3/6/98
 int		P_GetFriction(const AActor *mo, int *frictionfactor);
@@ -529,6 +556,7 @@ inline sector_t *P_PointInSector(fixed_t x, fixed_t y)
 // P_SETUP
 //
 extern BYTE*			rejectmatrix;	// for fast sight rejection
+extern BYTE*			generatedreject;	// built by P_BuildReject if the map has no REJECT
 extern int*				blockmaplump;	// offsets in blockmap are from here
 
 extern int*				blockmap;
@@ -538,6 +566,24 @@ extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
 extern FBlockNode**		blocklinks; 	// for thing chains
 
+// The same actors as blocklinks, kept in flat arrays that are cheaper to
+// scan than the node chains. Entries are oldest first, which is the
+// reverse of the chain order. Unlinking an actor only clears its entry;
+// the holes are squeezed out once they make up half of the list.
+struct FBlockActors
+{
+	TArray<AActor *> Actors;
+	TArray<DWORD> Origins;	// first block the actor is linked into
+	int Holes;				// entries whose actor has been unlinked
+
+	FBlockActors() : Holes(0) {}
+};
+enum
+{
+	BLOCKORIGIN_SINGLE = 0x8000		// the actor is linked into only this block
+};
+extern FBlockActors*	blockactors;
+
 
 
 //
@@ -74,6 +74,10 @@ TArray<line_t *> spechit;
 // Temporary holder for thing_sectorlist threads
 msecnode_t* sector_list = NULL;		// phares 3/16/98
 
+// Counts every node that was added to or removed from any sector thread.
+// P_ChangeSector uses it to tell when it has to rescan a sector's list.
+static unsigned SecnodeChanges;
+
 //==========================================================================
 //
 // GetCoefficientClosestPointInLine24
@@ -4877,12 +4881,109 @@ struct FChangePosition
 	int crushchange;
 	bool nofit;
 	bool movemidtex;
+	int skipplane;		// plane whose move can skip unaffected actors, or -1
 };
 
 TArray<AActor *> intersectors;
 
 EXTERN_CVAR(Int, cl_bloodtype)
 
+//=============================================================================
+//
+// IsInertForCheck
+//
+// True if P_CheckPosition on this actor cannot do anything but find its
+// floor and ceiling. It cannot be stopped, pick up, push, damage or
+// activate anything, and other actors do not change its floor.
+//
+//=============================================================================
+
+static bool IsInertForCheck(AActor *thing)
+{
+	return thing->player == NULL &&
+		!(thing->flags & (MF_SOLID | MF_MISSILE | MF_SKULLFLY | MF_PICKUP | MF_NOCLIP)) &&
+		!(thing->flags2 & (MF2_PASSMOBJ | MF2_BLASTED | MF2_PUSHWALL | MF2_IMPACT)) &&
+		!(thing->flags3 & MF3_ISMONSTER) &&
+		!(thing->flags6 & MF6_BLOCKEDBYSOLIDACTORS) &&
+		thing->Sector->e->XFloor.ffloors.Size() == 0;
+}
+
+//=============================================================================
+//
+// CanSkipPlaneMove
+//
+// The floor an actor is on is the highest floor of the sectors it touches
+// and its dropoff is the lowest. So if a moving floor was strictly between
+// the two before and after the move, neither changed; the same goes for a
+// ceiling that stayed above the actor's. The margin also covers the tiny
+// height difference within which P_LineOpening picks a floor by line side
+// instead of by height. This relies on the last full check still being
+// current, so it must have been made for the same position and size.
+//
+// The line a full check would leave in BlockingLine is the first one to
+// reach the final floor or ceiling height (or a blocking line), so it
+// doesn't change either. The caller restores it from the last check.
+//
+//=============================================================================
+
+static bool CanSkipPlaneMove(AActor *thing, FChangePosition *cpos)
+{
+	const FPlaneCheck &check = thing->LastPlaneCheck;
+
+	if (check.Sector == NULL || check.Sector != thing->Sector ||
+		check.X != thing->x || check.Y != thing->y || check.Z != thing->z ||
+		check.Radius != thing->radius || check.Height != thing->height ||
+		check.FloorZ != thing->floorz || check.DropoffZ != thing->dropoffz ||
+		check.CeilingZ != thing->ceilingz || !IsInertForCheck(thing))
+	{
+		return false;
+	}
+
+	fixed_t margin = cpos->moveamt + FRACUNIT;
+
+	if (cpos->skipplane == 0)
+	{
+		fixed_t z = cpos->sector->floorplane.ZatPoint(thing->x, thing->y);
+		return z - margin > thing->dropoffz && z + margin < thing->floorz;
+	}
+	else
+	{
+		fixed_t z = cpos->sector->ceilingplane.ZatPoint(thing->x, thing->y);
+		return z - margin > thing->ceilingz;
+	}
+}
+
+//=============================================================================
+//
+// CanSkipSector
+//
+// Whether skipping actors is possible at all for this sector's move. The
+// plane has to be flat, and nothing else may depend on its height: no 3D
+// floors, no 3D midtextures and no Strife railings.
+//
+//=============================================================================
+
+static bool CanSkipSector(sector_t *sector, int floorOrCeil)
+{
+	const secplane_t &plane = floorOrCeil == 0 ? sector->floorplane : sector->ceilingplane;
+
+	if ((plane.a | plane.b) != 0 ||
+		(level.flags2 & LEVEL2_RAILINGHACK) ||
+		sector->e->XFloor.ffloors.Size() != 0 ||
+		sector->e->XFloor.attached.Size() != 0)
+	{
+		return false;
+	}
+	for (int i = 0; i < sector->linecount; ++i)
+	{
+		if (sector->lines[i]->flags & ML_3DMIDTEX)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 //=============================================================================
 //
 // P_AdjustFloorCeil
@@ -4894,6 +4995,16 @@ bool P_AdjustFloorCeil(AActor *thing, FChangePosition *cpos)
 	int flags2 = thing->flags2 & MF2_PASSMOBJ;
 	FCheckPosition tm;
 
+	// Only inert actors can be skipped, and they don't care what this returns.
+	// The blocking fields are still set the way P_CheckPosition would have,
+	// since a failed move in between may have left others there.
+	if (cpos->skipplane >= 0 && CanSkipPlaneMove(thing, cpos))
+	{
+		thing->BlockingMobj = NULL;
+		thing->BlockingLine = thing->LastPlaneCheck.BlockingLine;
+		return true;
+	}
+
 	if ((thing->flags2 & MF2_PASSMOBJ) && (thing->flags3 & MF3_ISMONSTER))
 	{
 		tm.FromPMove = true;
@@ -4919,6 +5030,24 @@ bool P_AdjustFloorCeil(AActor *thing, FChangePosition *cpos)
 	// restore the PASSMOBJ flag but leave the other flags alone.
 	thing->flags2 = (thing->flags2 & ~MF2_PASSMOBJ) | flags2;
 
+	FPlaneCheck &check = thing->LastPlaneCheck;
+	if (!cpos->movemidtex && IsInertForCheck(thing))
+	{
+		check.Sector = thing->Sector;
+		check.X = thing->x;
+		check.Y = thing->y;
+		check.Z = thing->z;
+		check.Radius = thing->radius;
+		check.Height = thing->height;
+		check.FloorZ = thing->floorz;
+		check.DropoffZ = thing->dropoffz;
+		check.CeilingZ = thing->ceilingz;
+		check.BlockingLine = thing->BlockingLine;
+	}
+	else
+	{
+		check.Sector = NULL;
+	}
 	return isgood;
 }
 
@@ -5369,6 +5498,31 @@ void PIT_CeilingRaise(AActor *thing, FChangePosition *cpos)
 	}
 }
 
+//=============================================================================
+//
+// NextUnvisited
+//
+// Finds the first thing in the sector's list that has not been processed
+// yet. As long as no node was added or removed anywhere since the last one
+// was returned, all nodes before that one are still visited, so the search
+// can go on from there instead of from the head of the list. This returns
+// the same nodes in the same order as always starting over, but is linear
+// rather than quadratic in the number of things in the sector.
+//
+//=============================================================================
+
+static msecnode_t *NextUnvisited(sector_t *sec, msecnode_t *last, unsigned &changes)
+{
+	msecnode_t *n = (last != NULL && changes == SecnodeChanges) ? last->m_snext : sec->touching_thinglist;
+
+	while (n != NULL && n->visited)
+	{
+		n = n->m_snext;
+	}
+	changes = SecnodeChanges;
+	return n;
+}
+
 //=============================================================================
 //
 // P_ChangeSector	[RH] Was P_CheckSector in BOOM
@@ -5385,12 +5539,20 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 	void(*iterator)(AActor *, FChangePosition *);
 	void(*iterator2)(AActor *, FChangePosition *) = NULL;
 	msecnode_t *n;
+	unsigned changes;
+
+	P_InvalidateSightCache ();
+
+	// Clearing the visited flags below invalidates the list position of
+	// any P_ChangeSector call this one is nested in.
+	SecnodeChanges++;
 
 	cpos.nofit = false;
 	cpos.crushchange = crunch;
 	cpos.moveamt = abs(amt);
 	cpos.movemidtex = false;
 	cpos.sector = sector;
+	cpos.skipplane = -1;
 
 #ifdef _3DFLOORS
 	// Also process all sectors that have 3D floors transferred from the
@@ -5421,22 +5583,20 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 			if (sec->heightsec == sector) continue;
 
 			for (n = sec->touching_thinglist; n; n = n->m_snext) n->visited = false;
-			do
+			n = NULL;
+			while ((n = NextUnvisited(sec, n, changes)))
 			{
-				for (n = sec->touching_thinglist; n; n = n->m_snext)
+				n->visited = true;
+				if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
+					(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
 				{
-					if (!n->visited)
-					{
-						n->visited = true;
-						if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-							(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-						{
-							iterator(n->m_thing, &cpos);
-						}
-						break;
-					}
+					iterator(n->m_thing, &cpos);
+				}
+				else
+				{ // The move isn't checked for it, so the last check goes stale.
+					n->m_thing->LastPlaneCheck.Sector = NULL;
 				}
-			} while (n);
+			}
 		}
 	}
 	P_Recalculate3DFloors(sector);			// Must recalculate the 3d floor and light lists
@@ -5471,6 +5631,12 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 		return false;
 	}
 
+	// [RH] Actors that the move cannot affect are left alone.
+	if (!cpos.movemidtex && CanSkipSector(sector, floorOrCeil))
+	{
+		cpos.skipplane = floorOrCeil;
+	}
+
 	// killough 4/4/98: scan list front-to-back until empty or exhausted,
 	// restarting from beginning after each thing is processed. Avoids
 	// crashes, and is sure to examine all things in the sector, and only
@@ -5478,29 +5644,29 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 	// Things can arbitrarily be inserted and removed and it won't mess up.
 	//
 	// killough 4/7/98: simplified to avoid using complicated counter
+	//
+	// [RH] NextUnvisited only starts over when the list has changed.
 
 	// Mark all things invalid
 
 	for (n = sector->touching_thinglist; n; n = n->m_snext)
 		n->visited = false;
 
-	do
+	n = NULL;
+	while ((n = NextUnvisited(sector, n, changes)))	// unprocessed thing found
 	{
-		for (n = sector->touching_thinglist; n; n = n->m_snext)	// go through list
+		n->visited = true; 							// mark thing as processed
+		if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
+			(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
 		{
-			if (!n->visited)								// unprocessed thing found
-			{
-				n->visited = true; 							// mark thing as processed
-				if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-					(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-				{
-					iterator(n->m_thing, &cpos);		 			// process it
-					if (iterator2 != NULL) iterator2(n->m_thing, &cpos);
-				}
-				break;										// exit and start over
-			}
+			iterator(n->m_thing, &cpos);		 			// process it
+			if (iterator2 != NULL) iterator2(n->m_thing, &cpos);
 		}
-	} while (n);	// repeat from scratch until all things left are marked valid
+		else
+		{ // The move isn't checked for it, so the last check goes stale.
+			n->m_thing->LastPlaneCheck.Sector = NULL;
+		}
+	}
 
 	if (!cpos.nofit && !isreset /* && sector->MoreFlags & (SECF_UNDERWATERMASK)*/)
 	{
@@ -5540,9 +5706,15 @@ bool P_ChangeSector(sector_t *sector, int crunch, int amt, int floorOrCeil, bool
 // phares 3/21/98
 //
 // Maintain a freelist of msecnode_t's to reduce memory allocs and frees.
+// [RH] The nodes are allocated in blocks, which are only freed between
+// levels. Nodes of one block sit next to each other in memory, so walking
+// a sector's thing list doesn't jump all over the heap.
 //=============================================================================
 
+enum { SECNODE_BLOCK = 256 };
+
 msecnode_t *headsecnode = NULL;
+static TArray<msecnode_t *> SecnodeBlocks;
 
 //=============================================================================
 //
@@ -5557,15 +5729,19 @@ msecnode_t *P_GetSecnode()
 {
 	msecnode_t *node;
 
-	if (headsecnode)
-	{
-		node = headsecnode;
-		headsecnode = headsecnode->m_snext;
-	}
-	else
+	if (headsecnode == NULL)
 	{
-		node = (msecnode_t *)M_Malloc(sizeof(*node));
+		msecnode_t *block = (msecnode_t *)M_Malloc(SECNODE_BLOCK * sizeof(msecnode_t));
+
+		SecnodeBlocks.Push(block);
+		for (int i = SECNODE_BLOCK - 1; i >= 0; --i)
+		{
+			block[i].m_snext = headsecnode;
+			headsecnode = &block[i];
+		}
 	}
+	node = headsecnode;
+	headsecnode = headsecnode->m_snext;
 	return node;
 }
 
@@ -5583,6 +5759,24 @@ void P_PutSecnode(msecnode_t *node)
 	headsecnode = node;
 }
 
+//=============================================================================
+//
+// P_FreeSecnodes
+//
+// Frees all node blocks. Every node must be back on the freelist.
+//
+//=============================================================================
+
+void P_FreeSecnodes()
+{
+	for (unsigned i = 0; i < SecnodeBlocks.Size(); ++i)
+	{
+		M_Free(SecnodeBlocks[i]);
+	}
+	SecnodeBlocks.Clear();
+	headsecnode = NULL;
+}
+
 //=============================================================================
 // phares 3/16/98
 //
@@ -5619,6 +5813,7 @@ msecnode_t *P_AddSecnode(sector_t *s, AActor *thing, msecnode_t *nextnode)
 	// of the list.
 
 	node = P_GetSecnode();
+	SecnodeChanges++;
 
 	// killough 4/4/98, 4/7/98: mark new nodes unvisited.
 	node->visited = 0;
@@ -5684,6 +5879,7 @@ msecnode_t *P_DelSecnode(msecnode_t *node)
 		// Return this node to the freelist
 
 		P_PutSecnode(node);
+		SecnodeChanges++;
 		return tn;
 	}
 	return NULL;
@@ -27,6 +27,7 @@
 
 
 #include <stdlib.h>
+#include <algorithm>
 
 
 #include "m_bbox.h"
@@ -43,6 +44,9 @@
 
 static AActor *RoughBlockCheck (AActor *mo, int index, void *);
 
+// Counts how often actors have been linked into the blockmap.
+static unsigned BlockLinkCount;
+
 
 //==========================================================================
 //
@@ -251,6 +255,8 @@ void P_LineOpening (FLineOpening &open, AActor *actor, const line_t *linedef,
 
 void AActor::UnlinkFromWorld ()
 {
+	// The actor is about to move, so the last floor check no longer applies.
+	LastPlaneCheck.Sector = NULL;
 	sector_list = NULL;
 	if (!(flags & MF_NOSECTOR))
 	{
@@ -299,6 +305,15 @@ void AActor::UnlinkFromWorld ()
 				block->NextActor->PrevActor = block->PrevActor;
 			}
 			*(block->PrevActor) = block->NextActor;
+			if (blockactors != NULL)
+			{
+				FBlockActors &list = blockactors[block->BlockIndex];
+				list.Actors[block->ActorIndex] = NULL;
+				if (++list.Holes > 8 && list.Holes * 2 > (int)list.Actors.Size())
+				{
+					FBlockThingsIterator::CompactBlock (block->BlockIndex);
+				}
+			}
 			FBlockNode *next = block->NextBlock;
 			block->Release ();
 			block = next;
@@ -342,6 +357,7 @@ void AActor::LinkToWorld (sector_t *sec)
 	}
 	Sector = sec;
 	subsector = R_PointInSubsector(x, y);	// this is from the rendering nodes, not the gameplay nodes!
+	LastPlaneCheck.Sector = NULL;
 
 	if ( !(flags & MF_NOSECTOR) )
 	{
@@ -393,6 +409,12 @@ void AActor::LinkToWorld (sector_t *sec)
 			y1 = MAX (0, y1);
 			x2 = MIN (bmapwidth - 1, x2);
 			y2 = MIN (bmapheight - 1, y2);
+			DWORD origin = x1 | (y1 << 16);
+			BlockLinkCount++;
+			if (x1 == x2 && y1 == y2)
+			{
+				origin |= BLOCKORIGIN_SINGLE;
+			}
 			for (int y = y1; y <= y2; ++y)
 			{
 				for (int x = x1; x <= x2; ++x)
@@ -407,6 +429,8 @@ void AActor::LinkToWorld (sector_t *sec)
 					}
 					node->PrevActor = link;
 					*link = node;
+					node->ActorIndex = blockactors[y*bmapwidth + x].Actors.Push (this);
+					blockactors[y*bmapwidth + x].Origins.Push (origin);
 
 					// Link in to actor
 					node->PrevBlock = alink;
@@ -610,6 +634,7 @@ FBlockNode *FBlockNode::Create (AActor *who, int x, int y)
 		block = new FBlockNode;
 	}
 	block->BlockIndex = x + y*bmapwidth;
+	block->ActorIndex = -1;
 	block->Me = who;
 	block->NextActor = NULL;
 	block->PrevActor = NULL;
@@ -765,13 +790,19 @@ line_t *FBlockLinesIterator::Next()
 //
 //===========================================================================
 
+FBlockThingsIterator *FBlockThingsIterator::Active;
+
 FBlockThingsIterator::FBlockThingsIterator()
 : DynHash(0)
 {
 	minx = maxx = 0;
 	miny = maxy = 0;
+	UseHash = true;
+	LinkStamp = 0;
 	ClearHash();
-	block = NULL;
+	block = -1;
+	cursor = -1;
+	Register();
 }
 
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
@@ -781,8 +812,10 @@ FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int
 	maxx = _maxx;
 	miny = _miny;
 	maxy = _maxy;
+	UseHash = false;
 	ClearHash();
 	Reset();
+	Register();
 }
 
 FBlockThingsIterator::FBlockThingsIterator(const FBoundingBox &box)
@@ -792,8 +825,107 @@ FBlockThingsIterator::FBlockThingsIterator(const FBoundingBox &box)
 	miny = GetSafeBlockY(box.Bottom() - bmaporgy);
 	maxx = GetSafeBlockX(box.Right() - bmaporgx);
 	minx = GetSafeBlockX(box.Left() - bmaporgx);
+	UseHash = false;
 	ClearHash();
 	Reset();
+	Register();
+}
+
+FBlockThingsIterator::~FBlockThingsIterator()
+{
+	if ((*PrevActive = NextActive) != NULL)
+	{
+		NextActive->PrevActive = PrevActive;
+	}
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: Register
+//
+// Adds the iterator to the list of iterators that need to hear about
+// actors leaving a block.
+//
+//===========================================================================
+
+void FBlockThingsIterator::Register()
+{
+	if ((NextActive = Active) != NULL)
+	{
+		Active->PrevActive = &NextActive;
+	}
+	PrevActive = &Active;
+	Active = this;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: CompactBlock
+//
+// Removes the entries of unlinked actors from a block, keeping the order
+// of the others. Iterators that are scanning the block are moved along so
+// that they continue with the same actor.
+//
+//===========================================================================
+
+void FBlockThingsIterator::CompactBlock(int blockindex)
+{
+	FBlockActors &list = blockactors[blockindex];
+	unsigned int i, j;
+
+	for (FBlockThingsIterator *it = Active; it != NULL; it = it->NextActive)
+	{
+		if (it->block == blockindex)
+		{
+			int live = 0;
+			for (int k = 0; k <= it->cursor; ++k)
+			{
+				if (list.Actors[k] != NULL) live++;
+			}
+			it->cursor = live - 1;
+		}
+	}
+	for (i = j = 0; i < list.Actors.Size(); ++i)
+	{
+		AActor *me = list.Actors[i];
+		if (me == NULL)
+		{
+			continue;
+		}
+		if (i != j)
+		{
+			list.Actors[j] = me;
+			list.Origins[j] = list.Origins[i];
+			for (FBlockNode *node = me->BlockNode; node != NULL; node = node->NextBlock)
+			{
+				if (node->BlockIndex == blockindex)
+				{
+					node->ActorIndex = j;
+					break;
+				}
+			}
+		}
+		j++;
+	}
+	list.Actors.Resize(j);
+	list.Origins.Resize(j);
+	list.Holes = 0;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: Reset
+//
+//===========================================================================
+
+void FBlockThingsIterator::Reset()
+{
+	if (!UseHash)
+	{
+		ClearHash();
+		LinkStamp = BlockLinkCount;
+	}
+	StartBlock(minx, miny);
 }
 
 //===========================================================================
@@ -809,6 +941,50 @@ void FBlockThingsIterator::ClearHash()
 	DynHash.Clear();
 }
 
+//===========================================================================
+//
+// FBlockThingsIterator :: AddToHash
+//
+// Returns false if the actor was already in the hash.
+//
+//===========================================================================
+
+bool FBlockThingsIterator::AddToHash(AActor *me)
+{
+	size_t hash = ((size_t)me >> 3) % countof(Buckets);
+	HashEntry *entry;
+	int i;
+
+	for (i = Buckets[hash]; i >= 0; )
+	{
+		entry = GetHashEntry(i);
+		if (entry->Actor == me)
+		{
+			return false;
+		}
+		i = entry->Next;
+	}
+	if (NumFixedHash < (int)countof(FixedHash))
+	{
+		entry = &FixedHash[NumFixedHash];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = NumFixedHash++;
+	}
+	else
+	{
+		if (DynHash.Size() == 0)
+		{
+			DynHash.Grow(50);
+		}
+		i = DynHash.Reserve(1);
+		entry = &DynHash[i];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = i + countof(FixedHash);
+	}
+	entry->Actor = me;
+	return true;
+}
+
 //===========================================================================
 //
 // FBlockThingsIterator :: StartBlock
@@ -821,12 +997,14 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 	cury = y; 
 	if (x >= 0 && y >= 0 && x < bmapwidth && y <bmapheight)
 	{
-		block = blocklinks[y*bmapwidth + x];
+		block = y*bmapwidth + x;
+		cursor = blockactors[block].Actors.Size() - 1;
 	}
 	else
 	{
 		// invalid block
-		block = NULL;
+		block = -1;
+		cursor = -1;
 	}
 }
 
@@ -853,16 +1031,19 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 {
 	for (;;)
 	{
-		while (block != NULL)
+		while (cursor >= 0)
 		{
-			AActor *me = block->Me;
-			FBlockNode *mynode = block;
-			HashEntry *entry;
-			int i;
+			FBlockActors &list = blockactors[block];
+			AActor *me = list.Actors[cursor];
+			DWORD origin = list.Origins[cursor];
 
-			block = block->NextActor;
+			cursor--;
+			if (me == NULL)
+			{ // This actor has been unlinked.
+				continue;
+			}
 			// Don't recheck things that were already checked
-			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
+			if (origin & BLOCKORIGIN_SINGLE)
 			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
 				return me;
 			}
@@ -881,41 +1062,23 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 					return me;
 				}
 			}
-			else
+			else if (!UseHash && LinkStamp == BlockLinkCount)
 			{
-				size_t hash = ((size_t)me >> 3) % countof(Buckets);
-				for (i = Buckets[hash]; i >= 0; )
+				// The actor is returned from the first block it shares
+				// with the rectangle, which is the first one the
+				// iterator comes across. It still goes into the hash in
+				// case it is relinked into a later block of the rectangle
+				// before the query is done.
+				if (curx == MAX<int>(minx, origin & 0x7fff) && cury == MAX<int>(miny, origin >> 16))
 				{
-					entry = GetHashEntry(i);
-					if (entry->Actor == me)
-					{ // I've already been checked. Skip to the next actor.
-						break;
-					}
-					i = entry->Next;
-				}
-				if (i < 0)
-				{ // Add me to the hash table and return me.
-					if (NumFixedHash < (int)countof(FixedHash))
-					{
-						entry = &FixedHash[NumFixedHash];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = NumFixedHash++;
-					}
-					else
-					{
-						if (DynHash.Size() == 0)
-						{
-							DynHash.Grow(50);
-						}
-						i = DynHash.Reserve(1);
-						entry = &DynHash[i];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = i + countof(FixedHash);
-					}
-					entry->Actor = me;
+					AddToHash(me);
 					return me;
 				}
 			}
+			else if (AddToHash(me))
+			{ // Not checked yet.
+				return me;
+			}
 		}
 
 		if (++curx > maxx)
@@ -936,6 +1099,32 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 
 TArray<intercept_t> FPathTraverse::intercepts(128);
 
+//===========================================================================
+//
+// P_SortIntercepts
+//
+// Puts intercepts in the order they are crossed. Intercepts at the same
+// distance keep the order they were found in, which is the order that
+// repeatedly picking the nearest remaining one would have given them.
+//
+//===========================================================================
+
+struct FInterceptCompare
+{
+	bool operator() (const intercept_t &a, const intercept_t &b) const
+	{
+		return a.frac < b.frac;
+	}
+};
+
+void P_SortIntercepts (intercept_t *in, unsigned count)
+{
+	if (count > 1)
+	{
+		std::stable_sort (in, in + count, FInterceptCompare());
+	}
+}
+
 
 //===========================================================================
 //
@@ -1154,20 +1343,12 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 
 intercept_t *FPathTraverse::Next()
 {
-	intercept_t *in = NULL;
+	// The intercepts were sorted once they had all been collected.
+	if (intercept_pos >= intercepts.Size ()) return NULL;
 
-	fixed_t dist = FIXED_MAX;
-	for (unsigned scanpos = intercept_index; scanpos < intercepts.Size (); scanpos++)
-	{
-		intercept_t *scan = &intercepts[scanpos];
-		if (scan->frac < dist && !scan->done)
-		{
-			dist = scan->frac;
-			in = scan;
-		}
-	}
-	
-	if (dist > maxfrac || in == NULL) return NULL;	// checked everything in range			
+	intercept_t *in = &intercepts[intercept_pos];
+	if (in->frac > maxfrac) return NULL;	// checked everything in range
+	intercept_pos++;
 	in->done = true;
 	return in;
 }
@@ -1202,7 +1383,7 @@ FPathTraverse::FPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, in
 	int 		count;
 				
 	validcount++;
-	intercept_index = intercepts.Size();
+	intercept_index = intercept_pos = intercepts.Size();
 		
 	if ( ((x1-bmaporgx)&(MAPBLOCKSIZE-1)) == 0)
 		x1 += FRACUNIT; // don't side exactly on a line
@@ -1386,6 +1567,10 @@ FPathTraverse::FPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, in
 		}
 	}
 	maxfrac = FRACUNIT;
+	if (intercepts.Size() > intercept_index)
+	{
+		P_SortIntercepts (&intercepts[intercept_index], intercepts.Size() - intercept_index);
+	}
 }
 
 FPathTraverse::~FPathTraverse()
@@ -352,6 +352,7 @@ void AActor::Serialize (FArchive &arc)
 	if (arc.IsLoading ())
 	{
 		touching_sectorlist = NULL;
+		LastPlaneCheck.Sector = NULL;
 		LinkToWorld (Sector);
 		AddToHash ();
 		SetShade (fillcolor);
@@ -3907,6 +3908,7 @@ AActor *AActor::StaticSpawn (const PClass *type, fixed_t ix, fixed_t iy, fixed_t
 	actor->frame = st->GetFrame();
 	actor->renderflags = (actor->renderflags & ~RF_FULLBRIGHT) | st->GetFullbright();
 	actor->touching_sectorlist = NULL;	// NULL head of sector list // phares 3/13/98
+	actor->LastPlaneCheck.Sector = NULL;
 	if (G_SkillProperty(SKILLP_FastMonsters))
 		actor->Speed = actor->GetClass()->Meta.GetMetaFixed(AMETA_FastSpeed, actor->Speed);
 	actor->DamageMultiply = FRACUNIT;
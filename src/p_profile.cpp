@@ -0,0 +1,332 @@
+/*
+** p_profile.cpp
+** Per class, state and action function thinker profiler
+**
+**---------------------------------------------------------------------------
+**
+** "profilethinkers <tics> [file]" times every thinker tick and every
+** action function call for the given number of tics, then prints the most
+** expensive entries. If a file is given, all entries are also written to
+** it, as JSON if the name ends in .json and as CSV otherwise.
+**
+** Times are inclusive: an action that jumps to a state with another
+** action is charged for both, and a tick is charged for the actions it
+** calls. Weapon actions run while players think, so they show up under
+** actions but not under classes or states.
+**
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "tarray.h"
+#include "info.h"
+#include "actor.h"
+#include "dthinker.h"
+#include "r_state.h"
+#include "v_text.h"
+#include "thingdef/thingdef.h"
+#include "p_profile.h"
+#include "m_benchmark.h"
+
+struct FProfileEntry
+{
+	FProfileEntry() : Calls(0), TimeMS(0) {}
+	int Calls;
+	double TimeMS;
+};
+
+struct FProfileResult
+{
+	FString Name;
+	int Calls;
+	double TimeMS;
+};
+
+typedef TMap<const PClass *, FProfileEntry> FClassProfile;
+typedef TMap<const FState *, FProfileEntry> FStateProfile;
+
+bool ThinkProfiling;
+
+static FClassProfile ClassProfile;
+static FStateProfile StateProfile;
+static FStateProfile ActionProfile;
+static int ProfileTics, ProfileTicsLeft;
+static FString ProfileFile;
+
+//==========================================================================
+//
+// P_ProfileTick
+//
+// Called instead of thinker->Tick() while profiling.
+//
+//==========================================================================
+
+void P_ProfileTick (DThinker *thinker)
+{
+	const PClass *cls = thinker->GetClass();
+	const FState *state = NULL;
+	cycle_t time;
+
+	if (thinker->IsKindOf (RUNTIME_CLASS(AActor)))
+	{
+		state = static_cast<AActor *>(thinker)->state;
+	}
+	time.Reset();
+	time.Clock();
+	thinker->Tick ();
+	time.Unclock();
+
+	FProfileEntry &centry = ClassProfile[cls];
+	centry.Calls++;
+	centry.TimeMS += time.TimeMS();
+	if (state != NULL)
+	{
+		FProfileEntry &sentry = StateProfile[state];
+		sentry.Calls++;
+		sentry.TimeMS += time.TimeMS();
+	}
+}
+
+//==========================================================================
+//
+// FState :: CallProfiledAction
+//
+//==========================================================================
+
+void FState::CallProfiledAction (AActor *self, AActor *stateowner, StateCallData *statecall)
+{
+	cycle_t time;
+
+	time.Reset();
+	time.Clock();
+	ActionFunc (self, stateowner, this, ParameterIndex-1, statecall);
+	time.Unclock();
+
+	// Not looked up before the call, since nested actions may grow the map.
+	FProfileEntry &entry = ActionProfile[this];
+	entry.Calls++;
+	entry.TimeMS += time.TimeMS();
+}
+
+//==========================================================================
+//
+// Report helpers
+//
+//==========================================================================
+
+static FString StateName (const FState *state)
+{
+	const PClass *owner = FState::StaticFindStateOwner (state);
+	FString name;
+
+	if (owner == NULL)
+	{
+		name.Format ("%p", state);
+	}
+	else
+	{
+		name.Format ("%s.%d", owner->TypeName.GetChars(), int(state - owner->ActorInfo->OwnedStates));
+	}
+	if (state->sprite < sprites.Size())
+	{
+		name.AppendFormat (" %s %c", sprites[state->sprite].name, state->Frame + 'A');
+	}
+	return name;
+}
+
+static int STACK_ARGS CompareResults (const void *a, const void *b)
+{
+	double ta = ((const FProfileResult *)a)->TimeMS, tb = ((const FProfileResult *)b)->TimeMS;
+	return ta < tb ? 1 : ta > tb ? -1 : 0;
+}
+
+static void SortResults (TArray<FProfileResult> &results)
+{
+	if (results.Size() > 1)
+	{
+		qsort (&results[0], results.Size(), sizeof(FProfileResult), CompareResults);
+	}
+}
+
+static void AddResult (TArray<FProfileResult> &results, const FString &name, const FProfileEntry &entry)
+{
+	FProfileResult res;
+	res.Name = name;
+	res.Calls = entry.Calls;
+	res.TimeMS = entry.TimeMS;
+	results.Push (res);
+}
+
+static void PrintResults (const char *title, const TArray<FProfileResult> &results, unsigned count)
+{
+	Printf (TEXTCOLOR_YELLOW "%s\n", title);
+	for (unsigned i = 0; i < results.Size() && i < count; ++i)
+	{
+		Printf ("%9.3f ms %8d  %s\n", results[i].TimeMS, results[i].Calls, results[i].Name.GetChars());
+	}
+}
+
+// Names are quoted in the CSV file, with quotes inside them doubled.
+static void WriteCSV (FILE *f, const char *kind, const TArray<FProfileResult> &results)
+{
+	for (unsigned i = 0; i < results.Size(); ++i)
+	{
+		FString name = results[i].Name;
+		name.Substitute ("\"", "\"\"");
+		fprintf (f, "%s,\"%s\",%d,%.4f,%.4f\n", kind, name.GetChars(), results[i].Calls,
+			results[i].TimeMS, results[i].TimeMS / ProfileTics);
+	}
+}
+
+static void WriteJSON (FILE *f, const char *kind, const TArray<FProfileResult> &results, bool last)
+{
+	fprintf (f, "  \"%s\": [\n", kind);
+	for (unsigned i = 0; i < results.Size(); ++i)
+	{
+		fprintf (f, "    { \"name\": \"%s\", \"calls\": %d, \"ms\": %.4f, \"mspertic\": %.4f }%s\n",
+			M_EscapeJSON(results[i].Name).GetChars(), results[i].Calls, results[i].TimeMS, results[i].TimeMS / ProfileTics,
+			i + 1 < results.Size() ? "," : "");
+	}
+	fprintf (f, "  ]%s\n", last ? "" : ",");
+}
+
+//==========================================================================
+//
+// ProfileReport
+//
+//==========================================================================
+
+static void ProfileReport ()
+{
+	TArray<FProfileResult> classes, states, actions;
+
+	{
+		FClassProfile::Iterator it(ClassProfile);
+		FClassProfile::Pair *pair;
+		while (it.NextPair (pair))
+		{
+			AddResult (classes, pair->Key->TypeName.GetChars(), pair->Value);
+		}
+	}
+	{
+		FStateProfile::Iterator it(StateProfile);
+		FStateProfile::Pair *pair;
+		while (it.NextPair (pair))
+		{
+			AddResult (states, StateName (pair->Key), pair->Value);
+		}
+	}
+	{
+		// Several states usually share one action function.
+		TMap<FName, FProfileResult> byfunc;
+		FStateProfile::Iterator it(ActionProfile);
+		FStateProfile::Pair *pair;
+		while (it.NextPair (pair))
+		{
+			const char *funcname = FindFunctionName (pair->Key->ActionFunc);
+			FName name = funcname != NULL ? funcname : "<unknown>";
+			FProfileResult *res = byfunc.CheckKey (name);
+			if (res == NULL)
+			{
+				res = &byfunc[name];
+				res->Name = name.GetChars();
+				res->Calls = 0;
+				res->TimeMS = 0;
+			}
+			res->Calls += pair->Value.Calls;
+			res->TimeMS += pair->Value.TimeMS;
+		}
+		TMap<FName, FProfileResult>::Iterator it2(byfunc);
+		TMap<FName, FProfileResult>::Pair *pair2;
+		while (it2.NextPair (pair2))
+		{
+			actions.Push (pair2->Value);
+		}
+	}
+	SortResults (classes);
+	SortResults (states);
+	SortResults (actions);
+
+	Printf ("Thinker profile over %d tics:\n", ProfileTics);
+	PrintResults ("Classes", classes, 20);
+	PrintResults ("States", states, 20);
+	PrintResults ("Actions", actions, 20);
+
+	if (ProfileFile.IsNotEmpty())
+	{
+		FILE *f = fopen (ProfileFile, "w");
+		if (f == NULL)
+		{
+			Printf ("Could not open %s\n", ProfileFile.GetChars());
+			return;
+		}
+		if (ProfileFile.Len() >= 5 && stricmp (ProfileFile.Right(5), ".json") == 0)
+		{
+			fprintf (f, "{\n  \"tics\": %d,\n", ProfileTics);
+			WriteJSON (f, "classes", classes, false);
+			WriteJSON (f, "states", states, false);
+			WriteJSON (f, "actions", actions, true);
+			fprintf (f, "}\n");
+		}
+		else
+		{
+			fprintf (f, "kind,name,calls,ms,mspertic\n");
+			WriteCSV (f, "class", classes);
+			WriteCSV (f, "state", states);
+			WriteCSV (f, "action", actions);
+		}
+		fclose (f);
+		Printf ("Profile written to %s\n", ProfileFile.GetChars());
+	}
+}
+
+//==========================================================================
+//
+// P_ProfileTicDone
+//
+//==========================================================================
+
+void P_ProfileTicDone ()
+{
+	if (ThinkProfiling && --ProfileTicsLeft <= 0)
+	{
+		ThinkProfiling = false;
+		ProfileReport ();
+		ClassProfile.Clear ();
+		StateProfile.Clear ();
+		ActionProfile.Clear ();
+	}
+}
+
+//==========================================================================
+//
+// CCMD profilethinkers
+//
+//==========================================================================
+
+CCMD (profilethinkers)
+{
+	if (argv.argc() < 2)
+	{
+		Printf ("Usage: profilethinkers <tics> [file.csv|file.json]\n");
+		return;
+	}
+	int tics = atoi (argv[1]);
+	if (tics <= 0)
+	{
+		ThinkProfiling = false;
+		return;
+	}
+	ClassProfile.Clear ();
+	StateProfile.Clear ();
+	ActionProfile.Clear ();
+	ProfileTics = ProfileTicsLeft = tics;
+	ProfileFile = argv.argc() > 2 ? argv[2] : "";
+	ThinkProfiling = true;
+	Printf ("Profiling thinkers for %d tics\n", tics);
+}
@@ -0,0 +1,15 @@
+#ifndef __P_PROFILE_H__
+#define __P_PROFILE_H__
+
+class DThinker;
+
+// Instrumented thinker profiler. While it runs, every thinker tick is
+// timed and charged to the thinker's class and, for actors, to the state
+// the actor was in. Action function calls are timed per state and summed
+// per function when the report is made. ThinkProfiling is declared in
+// info.h so FState::CallAction can see it.
+
+void P_ProfileTick (DThinker *thinker);
+void P_ProfileTicDone ();
+
+#endif
@@ -0,0 +1,911 @@
+/*
+** p_reject.cpp
+** Builds a REJECT table for maps that don't come with one
+**
+**---------------------------------------------------------------------------
+**
+** Every two-sided line is a portal between the sectors on its sides. For
+** each sector, sight is flowed through chains of portals the same way
+** Quake's vis does it: a portal further down the chain is clipped to the
+** part that a straight line through all the portals before it can reach.
+** Any sector that is never reached can't possibly be seen.
+**
+** Heights are ignored, since sectors may move, and so are lines that block
+** sight, since their flags can be changed. The result is symmetric and
+** every sector is also allowed to see whatever its close neighbours see, to
+** cover trace start points that are nudged across a line. Sectors that
+** aren't properly closed, self-referencing sectors and lines missing from
+** the blockmap make everything involved visible. Maps with polyobjects are
+** skipped entirely, since those can carry lines anywhere.
+**
+** The table is kept apart from the map's own REJECT and is only consulted
+** by P_CheckSight once everything that might use a random number is done,
+** so it changes how fast sight checks are but never their outcome.
+**
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "templates.h"
+#include "tarray.h"
+#include "m_swap.h"
+#include "m_misc.h"
+#include "m_workers.h"
+#include "cmdlib.h"
+#include "w_wad.h"
+#include "md5.h"
+#include "p_local.h"
+#include "p_lnspec.h"
+#include "p_setup.h"
+#include "r_state.h"
+
+// Distance below which a point counts as being on a line.
+#define REJECT_EPSILON		2.0
+// Lines closer than this make their sectors share what they can see.
+#define REJECT_NEARDIST		4.0
+
+enum
+{
+	MAX_REJECT_SECTORS = 8192,
+	MAX_REJECT_DEPTH = 256,
+	REJECT_BUDGET = 1 << 16,
+	REJECT_CACHE_VERSION = 3
+};
+
+CVAR (Bool, genreject, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
+
+BYTE *generatedreject;
+
+struct FRejectSeg
+{
+	double x1, y1, x2, y2;
+};
+
+struct FRejectPortal
+{
+	FRejectSeg Seg;
+	double nx, ny, d;		// plane of the line, facing the sector it leads into
+	int Line;
+	int From, To;
+};
+
+struct FRejectMap
+{
+	int NumNodes;			// sectors + the void outside the map
+	int RowBytes;
+	TArray<FRejectPortal> Portals;
+	TArray<int> FirstPortal;
+	TArray<int> Component;
+	BYTE *Visible;
+};
+
+//==========================================================================
+//
+// Bit rows
+//
+//==========================================================================
+
+static inline void SetBit (BYTE *row, int bit)
+{
+	row[bit >> 3] |= 1 << (bit & 7);
+}
+
+static inline bool GetBit (const BYTE *row, int bit)
+{
+	return (row[bit >> 3] & (1 << (bit & 7))) != 0;
+}
+
+//==========================================================================
+//
+// ClipSeg
+//
+// Cuts away the part of s that is behind the plane, leaving a little
+// slack. Returns false if nothing is left.
+//
+//==========================================================================
+
+static bool ClipSeg (FRejectSeg &s, double nx, double ny, double d)
+{
+	double s1 = s.x1*nx + s.y1*ny - d + REJECT_EPSILON;
+	double s2 = s.x2*nx + s.y2*ny - d + REJECT_EPSILON;
+
+	if (s1 < 0 && s2 < 0)
+	{
+		return false;
+	}
+	if (s1 < 0)
+	{
+		double f = s1 / (s1 - s2);
+		s.x1 += (s.x2 - s.x1) * f;
+		s.y1 += (s.y2 - s.y1) * f;
+	}
+	else if (s2 < 0)
+	{
+		double f = s2 / (s2 - s1);
+		s.x2 += (s.x1 - s.x2) * f;
+		s.y2 += (s.y1 - s.y2) * f;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// ClipToSeparators
+//
+// Every straight line that crosses a and then b has to stay between the
+// lines that connect an end of a with an end of b while having a and b on
+// opposite sides. target, which lies beyond b, is clipped to that area.
+//
+//==========================================================================
+
+static bool ClipToSeparators (const FRejectSeg &a, const FRejectSeg &b, FRejectSeg &target)
+{
+	const double ax[2] = { a.x1, a.x2 }, ay[2] = { a.y1, a.y2 };
+	const double bx[2] = { b.x1, b.x2 }, by[2] = { b.y1, b.y2 };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			double dx = bx[j] - ax[i], dy = by[j] - ay[i];
+			double len = sqrt (dx*dx + dy*dy);
+
+			if (len < REJECT_EPSILON)
+			{
+				continue;
+			}
+			double nx = -dy / len, ny = dx / len;
+			double d = ax[i]*nx + ay[i]*ny;
+			double sa = ax[1-i]*nx + ay[1-i]*ny - d;
+			double sb = bx[1-j]*nx + by[1-j]*ny - d;
+
+			if (sa > REJECT_EPSILON && sb < -REJECT_EPSILON)
+			{
+				nx = -nx, ny = -ny, d = -d;
+			}
+			else if (!(sa < -REJECT_EPSILON && sb > REJECT_EPSILON))
+			{
+				continue;
+			}
+			if (!ClipSeg (target, nx, ny, d))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Flow
+//
+// Marks the sector behind pass as visible and continues through its
+// portals. src is the part of the first portal that can still see through
+// everything up to pass. Returns false if the work budget ran out.
+//
+//==========================================================================
+
+struct FRejectWork
+{
+	const FRejectMap *Map;
+	BYTE *Row;
+	BYTE *OnStack;
+	int Budget;
+};
+
+static bool Flow (FRejectWork &w, const FRejectPortal *first, const FRejectSeg &src,
+	const FRejectPortal *pass, const FRejectSeg &passseg, int depth)
+{
+	const FRejectMap *map = w.Map;
+	int sec = pass->To;
+
+	SetBit (w.Row, sec);
+	if (depth >= MAX_REJECT_DEPTH || --w.Budget < 0)
+	{
+		return false;
+	}
+	for (int i = map->FirstPortal[sec]; i < map->FirstPortal[sec+1]; ++i)
+	{
+		const FRejectPortal *p = &map->Portals[i];
+
+		if (w.OnStack[p->Line])
+		{
+			continue;
+		}
+		FRejectSeg target = p->Seg;
+		FRejectSeg newsrc = src;
+
+		if (!ClipSeg (target, pass->nx, pass->ny, pass->d))
+		{
+			continue;
+		}
+		if (pass != first)
+		{
+			if (!ClipSeg (target, first->nx, first->ny, first->d) ||
+				!ClipToSeparators (src, passseg, target) ||
+				!ClipToSeparators (target, passseg, newsrc))
+			{
+				continue;
+			}
+		}
+		w.OnStack[p->Line] = 1;
+		bool ok = Flow (w, first, newsrc, p, target, depth + 1);
+		w.OnStack[p->Line] = 0;
+		if (!ok)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// BuildRejectRow
+//
+// Worker job that finds everything one sector can see. If that takes too
+// long, everything connected to the sector is taken as visible instead.
+//
+//==========================================================================
+
+static void BuildRejectRow (int sec, void *data)
+{
+	const FRejectMap *map = (const FRejectMap *)data;
+	FRejectWork w;
+	bool ok = true;
+
+	w.Map = map;
+	w.Row = map->Visible + sec * map->RowBytes;
+	w.OnStack = new BYTE[numlines];
+	w.Budget = REJECT_BUDGET;
+	memset (w.OnStack, 0, numlines);
+
+	SetBit (w.Row, sec);
+	for (int i = map->FirstPortal[sec]; ok && i < map->FirstPortal[sec+1]; ++i)
+	{
+		const FRejectPortal *p = &map->Portals[i];
+
+		w.OnStack[p->Line] = 1;
+		ok = Flow (w, p, p->Seg, p, p->Seg, 1);
+		w.OnStack[p->Line] = 0;
+	}
+	if (!ok)
+	{
+		for (int i = 0; i < map->NumNodes; ++i)
+		{
+			if (map->Component[i] == map->Component[sec])
+			{
+				SetBit (w.Row, i);
+			}
+		}
+	}
+	delete[] w.OnStack;
+}
+
+//==========================================================================
+//
+// AddPortal
+//
+//==========================================================================
+
+static void AddPortal (TArray<FRejectPortal> &portals, const line_t *line, int from, int to, bool toisback)
+{
+	FRejectPortal p;
+	double dx = FIXED2DBL(line->dx), dy = FIXED2DBL(line->dy);
+	double len = sqrt (dx*dx + dy*dy);
+
+	p.Seg.x1 = FIXED2DBL(line->v1->x);
+	p.Seg.y1 = FIXED2DBL(line->v1->y);
+	p.Seg.x2 = FIXED2DBL(line->v2->x);
+	p.Seg.y2 = FIXED2DBL(line->v2->y);
+	// The back of a line is to the left of v1->v2.
+	p.nx = -dy / len;
+	p.ny = dx / len;
+	if (!toisback)
+	{
+		p.nx = -p.nx, p.ny = -p.ny;
+	}
+	p.d = p.Seg.x1*p.nx + p.Seg.y1*p.ny;
+	p.Line = int(line - lines);
+	p.From = from;
+	p.To = to;
+	portals.Push (p);
+}
+
+//==========================================================================
+//
+// FindComponent
+//
+//==========================================================================
+
+static int FindComponent (TArray<int> &comp, int i)
+{
+	while (comp[i] != i)
+	{
+		comp[i] = comp[comp[i]];
+		i = comp[i];
+	}
+	return i;
+}
+
+//==========================================================================
+//
+// JoinComponents / LabelComponents
+//
+// FindComponent only halves paths, so after joining, a node can still be
+// several steps from its root. LabelComponents points every node straight
+// at it.
+//
+//==========================================================================
+
+static void JoinComponents (TArray<int> &comp, int a, int b)
+{
+	a = FindComponent (comp, a);
+	b = FindComponent (comp, b);
+	comp[a] = b;
+}
+
+static void LabelComponents (TArray<int> &comp)
+{
+	for (unsigned i = 0; i < comp.Size(); ++i)
+	{
+		comp[i] = FindComponent (comp, i);
+	}
+}
+
+//==========================================================================
+//
+// CCMD testrejectcomponents
+//
+// Joins the nodes of a corridor one portal at a time, in both directions.
+// That builds the longest chains there are, and every node must still end
+// up labelled with the same root.
+//
+//==========================================================================
+
+CCMD (testrejectcomponents)
+{
+	const int corridor = 40;
+	TArray<int> comp;
+	int failed = 0;
+
+	comp.Resize (corridor);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		int i;
+
+		for (i = 0; i < corridor; ++i)
+		{
+			comp[i] = i;
+		}
+		for (i = 0; i < corridor - 1; ++i)
+		{
+			if (pass == 0)
+			{
+				JoinComponents (comp, i, i + 1);
+			}
+			else
+			{
+				JoinComponents (comp, corridor - 1 - i, corridor - 2 - i);
+			}
+		}
+		LabelComponents (comp);
+		for (i = 0; i < corridor; ++i)
+		{
+			if (comp[i] != comp[0] || comp[comp[i]] != comp[i])
+			{
+				Printf ("Pass %d: node %d is labelled %d instead of %d\n", pass, i, comp[i], comp[0]);
+				failed++;
+			}
+		}
+	}
+	Printf ("%s\n", failed == 0 ? "Reject components are labelled correctly." : "Reject component labelling is broken.");
+}
+
+//==========================================================================
+//
+// SegDistance
+//
+//==========================================================================
+
+static double PointSegDistance (double x, double y, const FRejectSeg &s)
+{
+	double dx = s.x2 - s.x1, dy = s.y2 - s.y1;
+	double len2 = dx*dx + dy*dy;
+	double t = len2 > 0 ? ((x - s.x1)*dx + (y - s.y1)*dy) / len2 : 0;
+
+	t = clamp (t, 0., 1.);
+	dx = s.x1 + t*dx - x;
+	dy = s.y1 + t*dy - y;
+	return sqrt (dx*dx + dy*dy);
+}
+
+static double SegDistance (const FRejectSeg &a, const FRejectSeg &b)
+{
+	double a1 = (b.x2 - b.x1)*(a.y1 - b.y1) - (b.y2 - b.y1)*(a.x1 - b.x1);
+	double a2 = (b.x2 - b.x1)*(a.y2 - b.y1) - (b.y2 - b.y1)*(a.x2 - b.x1);
+	double b1 = (a.x2 - a.x1)*(b.y1 - a.y1) - (a.y2 - a.y1)*(b.x1 - a.x1);
+	double b2 = (a.x2 - a.x1)*(b.y2 - a.y1) - (a.y2 - a.y1)*(b.x2 - a.x1);
+
+	if (((a1 <= 0 && a2 >= 0) || (a1 >= 0 && a2 <= 0)) &&
+		((b1 <= 0 && b2 >= 0) || (b1 >= 0 && b2 <= 0)))
+	{
+		return 0;
+	}
+	return MIN (MIN (PointSegDistance (a.x1, a.y1, b), PointSegDistance (a.x2, a.y2, b)),
+		MIN (PointSegDistance (b.x1, b.y1, a), PointSegDistance (b.x2, b.y2, a)));
+}
+
+static int BlockOf (const vertex_t *v)
+{
+	int x = (v->x - bmaporgx) >> MAPBLOCKSHIFT;
+	int y = (v->y - bmaporgy) >> MAPBLOCKSHIFT;
+
+	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+	{
+		return -1;
+	}
+	return y * bmapwidth + x;
+}
+
+static int STACK_ARGS CompareQWords (const void *a, const void *b)
+{
+	QWORD x = *(const QWORD *)a, y = *(const QWORD *)b;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+//==========================================================================
+//
+// FindNearSectors
+//
+// Collects the pairs of sectors that have lines within REJECT_NEARDIST of
+// each other. A pair is stored as (a << 32) | b, sorted by a.
+//
+//==========================================================================
+
+static void FindNearSectors (TArray<QWORD> &pairs)
+{
+	for (int i = 0; i < numlines; ++i)
+	{
+		const line_t *ld = &lines[i];
+		FRejectSeg a = { FIXED2DBL(ld->v1->x), FIXED2DBL(ld->v1->y), FIXED2DBL(ld->v2->x), FIXED2DBL(ld->v2->y) };
+		fixed_t near = FLOAT2FIXED(REJECT_NEARDIST);
+		int x1 = MAX (0, (ld->bbox[BOXLEFT] - near - bmaporgx) >> MAPBLOCKSHIFT);
+		int x2 = MIN (bmapwidth - 1, (ld->bbox[BOXRIGHT] + near - bmaporgx) >> MAPBLOCKSHIFT);
+		int y1 = MAX (0, (ld->bbox[BOXBOTTOM] - near - bmaporgy) >> MAPBLOCKSHIFT);
+		int y2 = MIN (bmapheight - 1, (ld->bbox[BOXTOP] + near - bmaporgy) >> MAPBLOCKSHIFT);
+
+		for (int y = y1; y <= y2; ++y)
+		{
+			for (int x = x1; x <= x2; ++x)
+			{
+				int offset = *(blockmap + y*bmapwidth + x);
+
+				for (int *list = blockmaplump + offset + 1; *list != -1; list++)
+				{
+					const line_t *ld2 = &lines[*list];
+					if (ld2 <= ld)
+					{
+						continue;
+					}
+					FRejectSeg b = { FIXED2DBL(ld2->v1->x), FIXED2DBL(ld2->v1->y), FIXED2DBL(ld2->v2->x), FIXED2DBL(ld2->v2->y) };
+					if (SegDistance (a, b) > REJECT_NEARDIST)
+					{
+						continue;
+					}
+					const sector_t *s1[2] = { ld->frontsector, ld->backsector };
+					const sector_t *s2[2] = { ld2->frontsector, ld2->backsector };
+					for (int j = 0; j < 2; ++j)
+					{
+						for (int k = 0; k < 2; ++k)
+						{
+							if (s1[j] != NULL && s2[k] != NULL && s1[j] != s2[k])
+							{
+								QWORD p = int(s1[j] - sectors), q = int(s2[k] - sectors);
+								pairs.Push ((p << 32) | q);
+								pairs.Push ((q << 32) | p);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	if (pairs.Size() > 0)
+	{
+		qsort (&pairs[0], pairs.Size(), sizeof(QWORD), CompareQWords);
+	}
+}
+
+//==========================================================================
+//
+// FindOpenSectors
+//
+// A sector whose lines don't form closed loops, or that has lines with
+// itself on both sides, can't be reasoned about.
+//
+//==========================================================================
+
+static void FindOpenSectors (BYTE *open)
+{
+	TArray<QWORD> ends;
+
+	for (int i = 0; i < numlines; ++i)
+	{
+		const line_t *ld = &lines[i];
+		const sector_t *sides[2] = { ld->frontsector, ld->backsector };
+
+		if (ld->frontsector == ld->backsector || (ld->dx | ld->dy) == 0)
+		{
+			for (int j = 0; j < 2; ++j)
+			{
+				if (sides[j] != NULL) open[sides[j] - sectors] = 1;
+			}
+			continue;
+		}
+		for (int j = 0; j < 2; ++j)
+		{
+			if (sides[j] != NULL)
+			{
+				QWORD sec = int(sides[j] - sectors);
+				ends.Push ((sec << 32) | int(ld->v1 - vertexes));
+				ends.Push ((sec << 32) | int(ld->v2 - vertexes));
+			}
+		}
+	}
+	if (ends.Size() > 0)
+	{
+		qsort (&ends[0], ends.Size(), sizeof(QWORD), CompareQWords);
+	}
+	for (unsigned i = 0; i < ends.Size(); )
+	{
+		unsigned j = i + 1;
+		while (j < ends.Size() && ends[j] == ends[i])
+		{
+			j++;
+		}
+		if ((j - i) & 1)
+		{
+			open[ends[i] >> 32] = 1;
+		}
+		i = j;
+	}
+}
+
+//==========================================================================
+//
+// Symmetrize
+//
+// Lets a see b whenever b can see a.
+//
+//==========================================================================
+
+static void Symmetrize (BYTE *rows, int rowbytes)
+{
+	for (int i = 0; i < numsectors; ++i)
+	{
+		BYTE *row = rows + i * rowbytes;
+		for (int j = i + 1; j < numsectors; ++j)
+		{
+			BYTE *other = rows + j * rowbytes;
+			if (GetBit (row, j) || GetBit (other, i))
+			{
+				SetBit (row, j);
+				SetBit (other, i);
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// ExpandNear
+//
+// dest gets src with the rows of every sector's neighbours added to its
+// own.
+//
+//==========================================================================
+
+static void ExpandNear (BYTE *dest, const BYTE *src, const TArray<QWORD> &near, int rowbytes)
+{
+	memcpy (dest, src, rowbytes * numsectors);
+	for (unsigned i = 0; i < near.Size(); ++i)
+	{
+		BYTE *to = dest + int(near[i] >> 32) * rowbytes;
+		const BYTE *from = src + int(near[i] & 0xFFFFFFFF) * rowbytes;
+		for (int j = 0; j < rowbytes; ++j)
+		{
+			to[j] |= from[j];
+		}
+	}
+}
+
+//==========================================================================
+//
+// Disk cache
+//
+// The table is stored next to the node cache and checked against a key
+// made from the map's checksum and the blockmap. The blockmap is part of
+// it because it need not come from the map: genblockmap and node
+// rebuilds generate a new one, which can list different lines. A table
+// without any hidden pairs is cached too, so the map isn't processed
+// again, but it is discarded on load just like a freshly built one.
+//
+//==========================================================================
+
+static void GetRejectKey (MapData *map, BYTE key[16])
+{
+	MD5Context md5;
+	BYTE mapsum[16];
+	DWORD val;
+	int i;
+
+	map->GetChecksum (mapsum);
+	md5.Update (mapsum, 16);
+	for (i = 0; i < 4; ++i)
+	{
+		val = LittleLong(DWORD(blockmaplump[i]));
+		md5.Update ((BYTE *)&val, 4);
+	}
+	for (i = 0; i < bmapwidth * bmapheight; ++i)
+	{
+		const int *list = blockmaplump + blockmap[i] + 1;
+		do
+		{
+			val = LittleLong(DWORD(*list));
+			md5.Update ((BYTE *)&val, 4);
+		} while (*list++ != -1);
+	}
+	md5.Final (key);
+}
+
+static FString RejectCacheName (MapData *map, bool create)
+{
+	FString path = M_GetCachePath(create);
+	FString lumpname = Wads.GetLumpFullPath(map->lumpnum);
+	int separator = lumpname.IndexOf(':');
+	path << '/' << lumpname.Left(separator);
+	if (create) CreatePath(path);
+
+	lumpname.ReplaceChars('/', '%');
+	path << '/' << lumpname.Right(lumpname.Len() - separator - 1) << ".rej";
+	return path;
+}
+
+static bool LoadCachedReject (MapData *map, const BYTE *md5, int size)
+{
+	FString path = RejectCacheName (map, false);
+	FILE *f = fopen (path, "rb");
+	DWORD header[3];
+	BYTE filemd5[16];
+	bool ok = false;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+	if (fread (header, 4, 3, f) == 3 && fread (filemd5, 1, 16, f) == 16 &&
+		header[0] == MAKE_ID('R','J','C','T') &&
+		LittleLong(header[1]) == REJECT_CACHE_VERSION &&
+		LittleLong(header[2]) == (DWORD)numsectors &&
+		memcmp (filemd5, md5, 16) == 0)
+	{
+		BYTE *reject = new BYTE[size];
+		if (fread (reject, 1, size, f) == (size_t)size)
+		{
+			ok = true;
+			for (int i = 0; i < size; ++i)
+			{
+				if (reject[i] != 0)
+				{
+					generatedreject = reject;
+					reject = NULL;
+					break;
+				}
+			}
+		}
+		delete[] reject;
+	}
+	fclose (f);
+	return ok;
+}
+
+static void SaveCachedReject (MapData *map, const BYTE *md5, const BYTE *reject, int size)
+{
+	FString path = RejectCacheName (map, true);
+	FILE *f = fopen (path, "wb");
+	DWORD header[3] = { MAKE_ID('R','J','C','T'), LittleLong(DWORD(REJECT_CACHE_VERSION)), LittleLong(DWORD(numsectors)) };
+
+	if (f != NULL)
+	{
+		bool ok = fwrite (header, 4, 3, f) == 3 && fwrite (md5, 1, 16, f) == 16 &&
+			fwrite (reject, 1, size, f) == (size_t)size;
+		fclose (f);
+		if (!ok)
+		{
+			remove (path);
+		}
+	}
+}
+
+//==========================================================================
+//
+// P_BuildReject
+//
+// Sets generatedreject, or leaves it NULL if the map can't be handled or
+// no pair of sectors turns out to be hidden from each other.
+//
+//==========================================================================
+
+void P_BuildReject (MapData *map)
+{
+	const int size = (numsectors * numsectors + 7) >> 3;
+	BYTE md5[16];
+	int i, j;
+
+	generatedreject = NULL;
+	if (numsectors < 2 || numsectors > MAX_REJECT_SECTORS)
+	{
+		return;
+	}
+	for (i = 0; i < numlines; ++i)
+	{
+		if (lines[i].special == Polyobj_StartLine || lines[i].special == Polyobj_ExplicitLine)
+		{
+			return;
+		}
+	}
+	GetRejectKey (map, md5);
+	if (LoadCachedReject (map, md5, size))
+	{
+		return;
+	}
+
+	FRejectMap rmap;
+	const int voidnode = numsectors;
+	TArray<FRejectPortal> portals;
+	TArray<BYTE> inblockmap, open;
+
+	rmap.NumNodes = numsectors + 1;
+	rmap.RowBytes = (rmap.NumNodes + 7) >> 3;
+
+	// A line only counts as being in the blockmap if the blocks of both its
+	// ends list it. That won't catch every broken blockmap, but it does
+	// catch lines that are missing entirely or stick out of the map.
+	inblockmap.Resize (numlines);
+	memset (&inblockmap[0], 0, numlines);
+	for (i = 0; i < bmapwidth * bmapheight; ++i)
+	{
+		for (int *list = blockmaplump + blockmap[i] + 1; *list != -1; list++)
+		{
+			const line_t *ld = &lines[*list];
+			if (BlockOf (ld->v1) == i) inblockmap[*list] |= 1;
+			if (BlockOf (ld->v2) == i) inblockmap[*list] |= 2;
+		}
+	}
+
+	// Sight can go through a line that isn't in the blockmap, so such
+	// lines lead into the void, which leads everywhere they do.
+	for (i = 0; i < numlines; ++i)
+	{
+		const line_t *ld = &lines[i];
+		int front = ld->frontsector != NULL ? int(ld->frontsector - sectors) : voidnode;
+		int back = ld->backsector != NULL ? int(ld->backsector - sectors) : voidnode;
+
+		if ((ld->dx | ld->dy) == 0)
+		{
+			continue;
+		}
+		if (inblockmap[i] != 3)
+		{
+			if (front == voidnode) front = back;
+			if (back == voidnode) back = front;
+			if (front == voidnode) continue;
+			AddPortal (portals, ld, front, voidnode, true);
+			AddPortal (portals, ld, voidnode, front, false);
+			if (back != front)
+			{
+				AddPortal (portals, ld, back, voidnode, false);
+				AddPortal (portals, ld, voidnode, back, true);
+			}
+		}
+		if (front != back && front != voidnode && back != voidnode)
+		{
+			AddPortal (portals, ld, front, back, true);
+			AddPortal (portals, ld, back, front, false);
+		}
+	}
+
+	// Sort the portals by the node they lead out of.
+	rmap.FirstPortal.Resize (rmap.NumNodes + 1);
+	memset (&rmap.FirstPortal[0], 0, sizeof(int) * (rmap.NumNodes + 1));
+	for (i = 0; i < (int)portals.Size(); ++i)
+	{
+		rmap.FirstPortal[portals[i].From + 1]++;
+	}
+	for (i = 0; i < rmap.NumNodes; ++i)
+	{
+		rmap.FirstPortal[i + 1] += rmap.FirstPortal[i];
+	}
+	rmap.Portals.Resize (portals.Size());
+	{
+		TArray<int> next;
+		next.Resize (rmap.NumNodes);
+		memcpy (&next[0], &rmap.FirstPortal[0], sizeof(int) * rmap.NumNodes);
+		for (i = 0; i < (int)portals.Size(); ++i)
+		{
+			rmap.Portals[next[portals[i].From]++] = portals[i];
+		}
+	}
+
+	rmap.Component.Resize (rmap.NumNodes);
+	for (i = 0; i < rmap.NumNodes; ++i)
+	{
+		rmap.Component[i] = i;
+	}
+	for (i = 0; i < (int)portals.Size(); ++i)
+	{
+		JoinComponents (rmap.Component, portals[i].From, portals[i].To);
+	}
+	LabelComponents (rmap.Component);
+
+	rmap.Visible = new BYTE[rmap.RowBytes * numsectors];
+	memset (rmap.Visible, 0, rmap.RowBytes * numsectors);
+	M_RunParallel (BuildRejectRow, &rmap, numsectors, M_GetCPUCount());
+
+	// Let every sector and everything it can see also see what their
+	// neighbours see.
+	TArray<QWORD> near;
+	BYTE *seen = new BYTE[rmap.RowBytes * numsectors];
+
+	FindNearSectors (near);
+	Symmetrize (rmap.Visible, rmap.RowBytes);
+	ExpandNear (seen, rmap.Visible, near, rmap.RowBytes);
+	Symmetrize (seen, rmap.RowBytes);
+	ExpandNear (rmap.Visible, seen, near, rmap.RowBytes);
+	Symmetrize (rmap.Visible, rmap.RowBytes);
+	delete[] seen;
+	seen = rmap.Visible;
+
+	open.Resize (numsectors);
+	memset (&open[0], 0, numsectors);
+	FindOpenSectors (&open[0]);
+
+	BYTE *reject = new BYTE[size];
+	bool rejectsany = false;
+
+	memset (reject, 0, size);
+	for (i = 0; i < numsectors; ++i)
+	{
+		const BYTE *row = seen + i * rmap.RowBytes;
+		if (open[i])
+		{
+			continue;
+		}
+		for (j = 0; j < numsectors; ++j)
+		{
+			if (!open[j] && !GetBit (row, j))
+			{
+				SetBit (reject, i * numsectors + j);
+				rejectsany = true;
+			}
+		}
+	}
+	delete[] seen;
+
+	SaveCachedReject (map, md5, reject, size);
+	if (rejectsany)
+	{
+		generatedreject = reject;
+	}
+	else
+	{
+		delete[] reject;
+	}
+}
@@ -93,10 +93,10 @@ EXTERN_CVAR(Bool, am_textured)
 
 CVAR (Bool, genblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, gennodes, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
+EXTERN_CVAR (Bool, genreject)
 CVAR (Bool, genglnodes, false, CVAR_SERVERINFO);
 CVAR (Bool, showloadtimes, false, 0);
 
-static void P_InitTagLists ();
 static void P_Shutdown ();
 
 bool P_IsBuildMap(MapData *map);
@@ -170,6 +170,7 @@ int				bmapnegx;		// min negs of block map before wrapping
 int				bmapnegy;
 
 FBlockNode**	blocklinks;		// for thing chains
+FBlockActors*	blockactors;
 
 
 // REJECT
@@ -3041,6 +3042,7 @@ void P_LoadBlockMap (MapData * map)
 	count = bmapwidth*bmapheight;
 	blocklinks = new FBlockNode *[count];
 	memset (blocklinks, 0, count*sizeof(*blocklinks));
+	blockactors = new FBlockActors[count];
 	blockmap = blockmaplump+4;
 }
 
@@ -3295,6 +3297,10 @@ void P_LoadReject (MapData * map, bool junk)
 		delete[] rejectmatrix;
 		rejectmatrix = NULL;
 	}
+	if (!junk && genreject)
+	{
+		P_BuildReject (map);
+	}
 }
 
 //
@@ -3311,32 +3317,6 @@ void P_LoadBehavior (MapData * map)
 	}
 }
 
-// Hash the sector tags across the sectors and linedefs.
-static void P_InitTagLists ()
-{
-	int i;
-
-	for (i=numsectors; --i>=0; )		// Initially make all slots empty.
-		sectors[i].firsttag = -1;
-	for (i=numsectors; --i>=0; )		// Proceed from last to first sector
-	{									// so that lower sectors appear first
-		int j = (unsigned) sectors[i].tag % (unsigned) numsectors;	// Hash func
-		sectors[i].nexttag = sectors[j].firsttag;	// Prepend sector to chain
-		sectors[j].firsttag = i;
-	}
-
-	// killough 4/17/98: same thing, only for linedefs
-
-	for (i=numlines; --i>=0; )			// Initially make all slots empty.
-		lines[i].firstid = -1;
-	for (i=numlines; --i>=0; )        // Proceed from last to first linedef
-	{									// so that lower linedefs appear first
-		int j = (unsigned) lines[i].id % (unsigned) numlines;	// Hash func
-		lines[i].nextid = lines[j].firstid;	// Prepend linedef to chain
-		lines[j].firstid = i;
-	}
-}
-
 void P_GetPolySpots (MapData * map, TArray<FNodeBuilder::FPolyStart> &spots, TArray<FNodeBuilder::FPolyStart> &anchors)
 {
 	if (map->HasBehavior)
@@ -3466,6 +3446,11 @@ void P_FreeLevelData ()
 		delete[] blocklinks;
 		blocklinks = NULL;
 	}
+	if (blockactors != NULL)
+	{
+		delete[] blockactors;
+		blockactors = NULL;
+	}
 	if (PolyBlockMap != NULL)
 	{
 		for (int i = bmapwidth*bmapheight-1; i >= 0; --i)
@@ -3486,6 +3471,12 @@ void P_FreeLevelData ()
 		delete[] rejectmatrix;
 		rejectmatrix = NULL;
 	}
+	if (generatedreject != NULL)
+	{
+		delete[] generatedreject;
+		generatedreject = NULL;
+	}
+	P_FreeTagLists ();
 	if (linebuffer != NULL)
 	{
 		delete[] linebuffer;
@@ -3512,8 +3503,6 @@ void P_FreeLevelData ()
 	P_ClearUDMFKeys();
 }
 
-extern msecnode_t *headsecnode;
-
 void P_FreeExtraLevelData()
 {
 	// Free all blocknodes and msecnodes.
@@ -3529,17 +3518,7 @@ void P_FreeExtraLevelData()
 		}
 		FBlockNode::FreeBlocks = NULL;
 	}
-	{
-		msecnode_t *node = headsecnode;
-
-		while (node != NULL)
-		{
-			msecnode_t *next = node->m_snext;
-			M_Free (node);
-			node = next;
-		}
-		headsecnode = NULL;
-	}
+	P_FreeSecnodes ();
 }
 
 //
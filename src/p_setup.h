@@ -126,6 +126,8 @@ bool P_CheckNodes(MapData * map, bool rebuilt, int buildtime);
 bool P_CheckForGLNodes();
 void P_SetRenderSector();
 
+void P_BuildReject(MapData * map);
+
 
 struct sidei_t	// [RH] Only keep BOOM sidedef init stuff around for init
 {
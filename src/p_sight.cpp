@@ -19,6 +19,9 @@
 #include "p_lnspec.h"
 #include "g_level.h"
 #include "po_man.h"
+#include "m_workers.h"
+#include "c_cvars.h"
+#include "statnums.h"
 
 // State.
 #include "r_state.h"
@@ -28,6 +31,8 @@
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
 
+CVAR (Bool, ai_parallelsight, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 /*
 ==============================================================================
 
@@ -43,7 +48,60 @@ static int sightcounts[6];
 static cycle_t SightCycles;
 static cycle_t MaxSightCycles;
 
-static TArray<intercept_t> intercepts (128);
+static TArray<intercept_t> SightIntercepts (128);
+
+// Sight cache
+//
+// Monsters ask the same sight questions many times per tic. The result of
+// the line traversal is remembered until the end of the tic, keyed by
+// both actors and everything about them the traversal looks at, so a hit
+// always gives the answer a fresh traversal would. Anything that changes
+// the map geometry in the meantime flushes the cache.
+
+struct FSightCacheEntry
+{
+	const AActor *t1, *t2;
+	const sector_t *s1, *s2;
+	fixed_t x1, y1, z1, height1;
+	fixed_t x2, y2, z2, height2;
+	int flags;
+	unsigned stamp;
+	bool result;
+};
+
+enum { SIGHTCACHE_MINSIZE = 1024, SIGHTCACHE_MAXSIZE = 65536 };
+
+static FSightCacheEntry *SightCache;
+static unsigned SightCacheSize;
+static unsigned SightCacheStamp = 1;
+static int SightCacheHits;
+
+// Sight checks run on worker threads mark the lines and polyobjects they
+// have looked at here instead of through validcount, and keep their own
+// intercepts and counters.
+
+struct FSightJob
+{
+	TArray<intercept_t> Intercepts;
+	TArray<int> LineMarks;
+	TArray<int> PolyMarks;
+	int Mark;
+	int Counts[6];
+	unsigned First, Last;
+};
+
+struct FSightQuery
+{
+	const AActor *t1, *t2;
+	int flags;
+	bool result;
+};
+
+enum { MAX_SIGHT_JOBS = 32, MIN_SIGHT_PREFETCH = 64 };
+
+static FSightJob SightJobs[MAX_SIGHT_JOBS];
+static TArray<FSightQuery> SightQueries;
+static int SightPrefetched;
 
 class SightCheck
 {
@@ -57,7 +115,12 @@ class SightCheck
 	int Flags;
 	divline_t trace;
 	int myseethrough;
+	FSightJob *Job;
+	int *Counts;
+	TArray<intercept_t> &intercepts;
 
+	bool MarkLine (line_t *ld);
+	bool MarkPolyobj (FPolyObj *po);
 	bool PTR_SightTraverse (intercept_t *in);
 	bool P_SightCheckLine (line_t *ld);
 	bool P_SightBlockLinesIterator (int x, int y);
@@ -66,7 +129,9 @@ class SightCheck
 public:
 	bool P_SightPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2);
 
-	SightCheck(const AActor * t1, const AActor * t2, int flags)
+	SightCheck(const AActor * t1, const AActor * t2, int flags, FSightJob *job = NULL)
+		: Job(job), Counts(job != NULL ? job->Counts : sightcounts),
+		  intercepts(job != NULL ? job->Intercepts : SightIntercepts)
 	{
 		lastztop = lastzbottom = sightzstart = t1->z + t1->height - (t1->height>>2);
 		lastsector = t1->Sector;
@@ -226,6 +291,48 @@ bool SightCheck::PTR_SightTraverse (intercept_t *in)
 
 
 
+//==========================================================================
+//
+// SightCheck :: MarkLine
+// SightCheck :: MarkPolyobj
+//
+// Return false if this traversal has already looked at the line or
+// polyobject.
+//
+//==========================================================================
+
+bool SightCheck::MarkLine (line_t *ld)
+{
+	if (Job != NULL)
+	{
+		int &mark = Job->LineMarks[int(ld - lines)];
+		if (mark == Job->Mark) return false;
+		mark = Job->Mark;
+	}
+	else
+	{
+		if (ld->validcount == validcount) return false;
+		ld->validcount = validcount;
+	}
+	return true;
+}
+
+bool SightCheck::MarkPolyobj (FPolyObj *po)
+{
+	if (Job != NULL)
+	{
+		int &mark = Job->PolyMarks[int(po - polyobjs)];
+		if (mark == Job->Mark) return false;
+		mark = Job->Mark;
+	}
+	else
+	{
+		if (po->validcount == validcount) return false;
+		po->validcount = validcount;
+	}
+	return true;
+}
+
 /*
 ==================
 =
@@ -238,11 +345,10 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 {
 	divline_t dl;
 
-	if (ld->validcount == validcount)
+	if (!MarkLine (ld))
 	{
 		return true;
 	}
-	ld->validcount = validcount;
 	if (P_PointOnDivlineSide (ld->v1->x, ld->v1->y, &trace) ==
 		P_PointOnDivlineSide (ld->v2->x, ld->v2->y, &trace))
 	{
@@ -287,7 +393,7 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 		}
 	}
 
-	sightcounts[3]++;
+	Counts[3]++;
 	// store the line for later intersection testing
 	intercept_t newintercept;
 	newintercept.isaline = true;
@@ -321,9 +427,8 @@ bool SightCheck::P_SightBlockLinesIterator (int x, int y)
 	{
 		if (polyLink->polyobj)
 		{ // only check non-empty links
-			if (polyLink->polyobj->validcount != validcount)
+			if (MarkPolyobj (polyLink->polyobj))
 			{
-				polyLink->polyobj->validcount = validcount;
 				for (i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
 				{
 					if (!P_SightCheckLine (polyLink->polyobj->Linedefs[i]))
@@ -356,13 +461,10 @@ bool SightCheck::P_SightBlockLinesIterator (int x, int y)
 
 bool SightCheck::P_SightTraverseIntercepts ()
 {
-	unsigned count;
-	fixed_t dist;
-	intercept_t *scan, *in;
+	intercept_t *scan;
 	unsigned scanpos;
 	divline_t dl;
 
-	count = intercepts.Size ();
 //
 // calculate intercept distance
 //
@@ -378,27 +480,14 @@ bool SightCheck::P_SightTraverseIntercepts ()
 // [RH] Is it really necessary to go through in order? All we care about is if
 // the trace is obstructed, not what specifically obstructed it.
 //
-	in = NULL;
-
-	while (count--)
+	if (intercepts.Size() > 0)
 	{
-		dist = FIXED_MAX;
-		for (scanpos = 0; scanpos < intercepts.Size (); scanpos++)
-		{
-			scan = &intercepts[scanpos];
-			if (scan->frac < dist)
-			{
-				dist = scan->frac;
-				in = scan;
-			}
-		}
-
-		if (in != NULL)
-		{
-			if (!PTR_SightTraverse (in))
-				return false;					// don't bother going farther
-			in->frac = FIXED_MAX;
-		}
+		P_SortIntercepts (&intercepts[0], intercepts.Size());
+	}
+	for (scanpos = 0; scanpos < intercepts.Size (); scanpos++)
+	{
+		if (!PTR_SightTraverse (&intercepts[scanpos]))
+			return false;					// don't bother going farther
 	}
 
 #ifdef _3DFLOORS
@@ -450,7 +539,14 @@ bool SightCheck::P_SightPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_
 	int mapx, mapy, mapxstep, mapystep;
 	int count;
 
-	validcount++;
+	if (Job != NULL)
+	{
+		Job->Mark++;
+	}
+	else
+	{
+		validcount++;
+	}
 	intercepts.Clear ();
 
 #ifdef _3DFLOORS
@@ -575,7 +671,7 @@ bool SightCheck::P_SightPathTraverse (fixed_t x1, fixed_t y1, fixed_t x2, fixed_
 	{
 		if (!P_SightBlockLinesIterator (mapx, mapy))
 		{
-sightcounts[1]++;
+Counts[1]++;
 			return false;	// early out
 		}
 
@@ -585,7 +681,7 @@ sightcounts[1]++;
 		switch ((((yintercept >> FRACBITS) == mapy) << 1) | ((xintercept >> FRACBITS) == mapx))
 		{
 		case 0:		// neither xintercept nor yintercept match!
-sightcounts[5]++;
+Counts[5]++;
 			// Continuing won't make things any better, so we might as well stop right here
 			count = 100;
 			break;
@@ -605,7 +701,7 @@ sightcounts[5]++;
 			break;
 
 		case 3:		// xintercept and yintercept both match
-			sightcounts[4]++;
+			Counts[4]++;
 			// The trace is exiting a block through its corner. Not only does the block
 			// being entered need to be checked (which will happen when this loop
 			// continues), but the other two blocks adjacent to the corner also need to
@@ -613,7 +709,7 @@ sightcounts[5]++;
 			if (!P_SightBlockLinesIterator (mapx + mapxstep, mapy) ||
 				!P_SightBlockLinesIterator (mapx, mapy + mapystep))
 			{
-sightcounts[1]++;
+Counts[1]++;
 				return false;
 			}
 			xintercept += xstep;
@@ -632,11 +728,62 @@ sightcounts[1]++;
 //
 // couldn't early out, so go through the sorted list
 //
-sightcounts[2]++;
+Counts[2]++;
 
 	return P_SightTraverseIntercepts ( );
 }
 
+//==========================================================================
+//
+// Sight cache access
+//
+//==========================================================================
+
+static void ResizeSightCache (unsigned size)
+{
+	delete[] SightCache;
+	SightCache = new FSightCacheEntry[size];
+	SightCacheSize = size;
+	memset (SightCache, 0, sizeof(FSightCacheEntry) * size);
+}
+
+static FSightCacheEntry *GetSightCacheEntry (const AActor *t1, const AActor *t2, int flags)
+{
+	if (SightCache == NULL)
+	{
+		ResizeSightCache (SIGHTCACHE_MINSIZE);
+	}
+	size_t hash = (size_t)t1 * 0x9E3779B1u ^ (size_t)t2 * 0x85EBCA6Bu ^ (size_t)flags;
+	return &SightCache[(hash >> 8) & (SightCacheSize - 1)];
+}
+
+static bool SightCacheEntryMatches (const FSightCacheEntry *entry, const AActor *t1, const AActor *t2, int flags)
+{
+	return entry->stamp == SightCacheStamp && entry->t1 == t1 && entry->t2 == t2 &&
+		entry->flags == flags && entry->s1 == t1->Sector && entry->s2 == t2->Sector &&
+		entry->x1 == t1->x && entry->y1 == t1->y && entry->z1 == t1->z && entry->height1 == t1->height &&
+		entry->x2 == t2->x && entry->y2 == t2->y && entry->z2 == t2->z && entry->height2 == t2->height;
+}
+
+static void SetSightCacheEntry (FSightCacheEntry *entry, const AActor *t1, const AActor *t2, int flags, bool result)
+{
+	entry->t1 = t1;
+	entry->t2 = t2;
+	entry->s1 = t1->Sector;
+	entry->s2 = t2->Sector;
+	entry->x1 = t1->x;
+	entry->y1 = t1->y;
+	entry->z1 = t1->z;
+	entry->height1 = t1->height;
+	entry->x2 = t2->x;
+	entry->y2 = t2->y;
+	entry->z2 = t2->z;
+	entry->height2 = t2->height;
+	entry->flags = flags;
+	entry->stamp = SightCacheStamp;
+	entry->result = result;
+}
+
 /*
 =====================
 =
@@ -713,13 +860,35 @@ sightcounts[0]++;
 		}
 	}
 
+	// The generated reject table is only checked down here so that it can't
+	// change whether the random number above gets used.
+	if (generatedreject != NULL &&
+		(generatedreject[pnum>>3] & (1 << (pnum & 7))))
+	{
+sightcounts[0]++;
+		res = false;
+		goto done;
+	}
+
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
 
-	validcount++;
 	{
-		SightCheck s(t1, t2, flags);
-		res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		FSightCacheEntry *entry = GetSightCacheEntry (t1, t2, flags);
+
+		if (SightCacheEntryMatches (entry, t1, t2, flags))
+		{
+			SightCacheHits++;
+			res = entry->result;
+			goto done;
+		}
+
+		validcount++;
+		{
+			SightCheck s(t1, t2, flags);
+			res = s.P_SightPathTraverse (t1->x, t1->y, t2->x, t2->y);
+		}
+		SetSightCacheEntry (entry, t1, t2, flags, res);
 	}
 
 done:
@@ -730,14 +899,61 @@ done:
 ADD_STAT (sight)
 {
 	FString out;
-	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d\n",
+	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d, %d cached, %d prefetched\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
-		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5]);
+		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5],
+		SightCacheHits, SightPrefetched);
 	return out;
 }
 
+//==========================================================================
+//
+// P_InvalidateSightCache
+//
+// Must be called whenever something a sight check looks at other than
+// the two actors changes: plane heights, polyobject positions and
+// sight blocking line flags.
+//
+//==========================================================================
+
+void P_InvalidateSightCache ()
+{
+	if (++SightCacheStamp == 0)
+	{
+		if (SightCache != NULL)
+		{
+			memset (SightCache, 0, sizeof(FSightCacheEntry) * SightCacheSize);
+		}
+		SightCacheStamp = 1;
+	}
+}
+
+//==========================================================================
+//
+// P_SetLineFlags
+//
+// Clears and then sets flags on a line. Flags that block lines while the
+// level is running should be changed through here, so that the sight
+// cache is invalidated when sight checks would see something different.
+//
+//==========================================================================
+
+void P_SetLineFlags (line_t *line, DWORD clear, DWORD set)
+{
+	DWORD oldflags = line->flags;
+
+	line->flags = (oldflags & ~clear) | set;
+	if ((oldflags ^ line->flags) & (ML_TWOSIDED|ML_BLOCKSIGHT|ML_BLOCKEVERYTHING))
+	{
+		P_InvalidateSightCache ();
+	}
+}
+
 void P_ResetSightCounters (bool full)
 {
+	P_InvalidateSightCache ();
+	SightCacheHits = 0;
+	SightPrefetched = 0;
 	if (full)
 	{
 		MaxSightCycles.Reset();
@@ -751,3 +967,135 @@ void P_ResetSightCounters (bool full)
 }
 
 
+//==========================================================================
+//
+// PrefetchSightJob
+//
+//==========================================================================
+
+static void PrefetchSightJob (int job, void *data)
+{
+	FSightJob *j = &SightJobs[job];
+
+	for (unsigned i = j->First; i < j->Last; ++i)
+	{
+		FSightQuery &q = SightQueries[i];
+		SightCheck s(q.t1, q.t2, q.flags, j);
+		q.result = s.P_SightPathTraverse (q.t1->x, q.t1->y, q.t2->x, q.t2->y);
+	}
+}
+
+//==========================================================================
+//
+// AddSightQuery
+//
+//==========================================================================
+
+static void AddSightQuery (const AActor *t1, const AActor *t2, int flags)
+{
+	int pnum = int(t1->Sector - sectors) * numsectors + int(t2->Sector - sectors);
+
+	if ((rejectmatrix != NULL && (rejectmatrix[pnum>>3] & (1 << (pnum & 7)))) ||
+		(generatedreject != NULL && (generatedreject[pnum>>3] & (1 << (pnum & 7)))))
+	{
+		return;
+	}
+	FSightQuery q = { t1, t2, flags, false };
+	SightQueries.Push (q);
+}
+
+//==========================================================================
+//
+// P_PrefetchSightChecks
+//
+// Runs the line traversals for the sight checks monsters are most likely
+// to make this tic on the worker threads and puts the results into the
+// sight cache. When a monster makes the check, the cache only answers it
+// if neither actor nor the map has changed since, so the game plays out
+// exactly as it would without this. Called right before the monsters
+// think.
+//
+//==========================================================================
+
+void P_PrefetchSightChecks ()
+{
+	if (!ai_parallelsight || (netgame && !demoplayback) || (level.flags2 & LEVEL2_FROZEN))
+	{
+		return;
+	}
+
+	TThinkerIterator<AActor> it(STAT_DEFAULT);
+	AActor *mo;
+
+	SightQueries.Clear ();
+	while ((mo = it.Next()) != NULL)
+	{
+		if (!(mo->flags3 & MF3_ISMONSTER) || mo->health <= 0 || (mo->flags2 & MF2_DORMANT))
+		{
+			continue;
+		}
+		if (mo->target != NULL)
+		{
+			// A_Chase's P_CheckMissileRange
+			AddSightQuery (mo, mo->target, SF_SEEPASTBLOCKEVERYTHING);
+		}
+		else
+		{
+			// A_Look's P_LookForPlayers
+			for (int i = 0; i < MAXPLAYERS; ++i)
+			{
+				if (playeringame[i] && players[i].mo != NULL && players[i].health > 0)
+				{
+					AddSightQuery (mo, players[i].mo, SF_SEEPASTSHOOTABLELINES);
+				}
+			}
+		}
+	}
+	if (SightQueries.Size() < MIN_SIGHT_PREFETCH)
+	{
+		return;
+	}
+
+	int numjobs = MIN<int> (M_GetCPUCount(), MAX_SIGHT_JOBS);
+	unsigned count = SightQueries.Size();
+	unsigned size = SIGHTCACHE_MINSIZE;
+
+	for (int i = 0; i < numjobs; ++i)
+	{
+		FSightJob *j = &SightJobs[i];
+
+		if (j->LineMarks.Size() != (unsigned)numlines)
+		{
+			j->LineMarks.Resize (numlines);
+			memset (&j->LineMarks[0], 0, numlines * sizeof(int));
+		}
+		if (j->PolyMarks.Size() != (unsigned)po_NumPolyobjs)
+		{
+			j->PolyMarks.Resize (po_NumPolyobjs);
+			if (po_NumPolyobjs > 0)
+			{
+				memset (&j->PolyMarks[0], 0, po_NumPolyobjs * sizeof(int));
+			}
+		}
+		j->First = count * i / numjobs;
+		j->Last = count * (i + 1) / numjobs;
+	}
+	M_RunParallel (PrefetchSightJob, NULL, numjobs, numjobs);
+
+	// Make the cache big enough that the results don't push each other
+	// out too often.
+	while (size < count * 4 && size < SIGHTCACHE_MAXSIZE)
+	{
+		size <<= 1;
+	}
+	if (size > SightCacheSize)
+	{
+		ResizeSightCache (size);
+	}
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const FSightQuery &q = SightQueries[i];
+		SetSightCacheEntry (GetSightCacheEntry (q.t1, q.t2, q.flags), q.t1, q.t2, q.flags, q.result);
+	}
+	SightPrefetched += count;
+}
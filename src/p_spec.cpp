@@ -182,42 +182,6 @@ bool CheckIfExitIsGood (AActor *self, level_info_t *info)
 }
 
 
-//
-// UTILITIES
-//
-
-
-
-//
-// RETURN NEXT SECTOR # THAT LINE TAG REFERS TO
-//
-
-// Find the next sector with a specified tag.
-// Rewritten by Lee Killough to use chained hashing to improve speed
-
-int P_FindSectorFromTag (int tag, int start)
-{
-	start = start >= 0 ? sectors[start].nexttag :
-		sectors[(unsigned) tag % (unsigned) numsectors].firsttag;
-	while (start >= 0 && sectors[start].tag != tag)
-		start = sectors[start].nexttag;
-	return start;
-}
-
-// killough 4/16/98: Same thing, only for linedefs
-
-int P_FindLineFromID (int id, int start)
-{
-	start = start >= 0 ? lines[start].nextid :
-		lines[(unsigned) id % (unsigned) numlines].firstid;
-	while (start >= 0 && lines[start].id != id)
-		start = lines[start].nextid;
-	return start;
-}
-
-
-
-
 //============================================================================
 //
 // P_ActivateLine
@@ -659,7 +623,8 @@ void P_SectorDamage(int tag, int amount, FName type, const PClass *protectClass,
 {
 	int secnum = -1;
 
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		AActor *actor, *next;
 		sector_t *sec = &sectors[secnum];
@@ -884,12 +849,12 @@ DLightTransfer::DLightTransfer (sector_t *srcSec, int target, bool copyFloor)
 
 	if (copyFloor)
 	{
-		for (secnum = -1; (secnum = P_FindSectorFromTag (target, secnum)) >= 0; )
+		for (FSectorTagIterator itr(target); (secnum = itr.Next()) >= 0; )
 			sectors[secnum].ChangeFlags(sector_t::floor, 0, PLANEF_ABSLIGHTING);
 	}
 	else
 	{
-		for (secnum = -1; (secnum = P_FindSectorFromTag (target, secnum)) >= 0; )
+		for (FSectorTagIterator itr(target); (secnum = itr.Next()) >= 0; )
 			sectors[secnum].ChangeFlags(sector_t::ceiling, 0, PLANEF_ABSLIGHTING);
 	}
 	ChangeStatNum (STAT_LIGHTTRANSFER);
@@ -912,12 +877,12 @@ void DLightTransfer::DoTransfer (int level, int target, bool floor)
 
 	if (floor)
 	{
-		for (secnum = -1; (secnum = P_FindSectorFromTag (target, secnum)) >= 0; )
+		for (FSectorTagIterator itr(target); (secnum = itr.Next()) >= 0; )
 			sectors[secnum].SetPlaneLight(sector_t::floor, level);
 	}
 	else
 	{
-		for (secnum = -1; (secnum = P_FindSectorFromTag (target, secnum)) >= 0; )
+		for (FSectorTagIterator itr(target); (secnum = itr.Next()) >= 0; )
 			sectors[secnum].SetPlaneLight(sector_t::ceiling, level);
 	}
 }
@@ -985,7 +950,7 @@ DWallLightTransfer::DWallLightTransfer (sector_t *srcSec, int target, BYTE flags
 		wallflags = WALLF_ABSLIGHTING | WALLF_NOFAKECONTRAST;
 	}
 
-	for (linenum = -1; (linenum = P_FindLineFromID (target, linenum)) >= 0; )
+	for (FLineIdIterator itr(target); (linenum = itr.Next()) >= 0; )
 	{
 		if (flags & WLF_SIDE1 && lines[linenum].sidedef[0] != NULL)
 		{
@@ -1015,7 +980,7 @@ void DWallLightTransfer::DoTransfer (short lightlevel, int target, BYTE flags)
 {
 	int linenum;
 
-	for (linenum = -1; (linenum = P_FindLineFromID (target, linenum)) >= 0; )
+	for (FLineIdIterator itr(target); (linenum = itr.Next()) >= 0; )
 	{
 		line_t *line = &lines[linenum];
 
@@ -1399,7 +1364,7 @@ void P_SpawnSpecials (void)
 			{
 				sec->MoreFlags |= SECF_NOFAKELIGHT;
 			}
-			for (s = -1; (s = P_FindSectorFromTag(lines[i].args[0],s)) >= 0;)
+			for (FSectorTagIterator itr(lines[i].args[0]); (s = itr.Next()) >= 0; )
 			{
 				sectors[s].heightsec = sec;
 				sec->e->FakeFloor.Sectors.Push(&sectors[s]);
@@ -1459,7 +1424,7 @@ void P_SpawnSpecials (void)
 			case Init_Gravity:
 				{
 				float grav = ((float)P_AproxDistance (lines[i].dx, lines[i].dy)) / (FRACUNIT * 100.0f);
-				for (s = -1; (s = P_FindSectorFromTag(lines[i].args[0],s)) >= 0;)
+				for (FSectorTagIterator itr(lines[i].args[0]); (s = itr.Next()) >= 0; )
 					sectors[s].gravity = grav;
 				}
 				break;
@@ -1470,7 +1435,7 @@ void P_SpawnSpecials (void)
 			case Init_Damage:
 				{
 					int damage = P_AproxDistance (lines[i].dx, lines[i].dy) >> FRACBITS;
-					for (s = -1; (s = P_FindSectorFromTag(lines[i].args[0],s)) >= 0;)
+					for (FSectorTagIterator itr(lines[i].args[0]); (s = itr.Next()) >= 0; )
 					{
 						sectors[s].damage = damage;
 						sectors[s].mod = 0;//MOD_UNKNOWN;
@@ -1493,7 +1458,7 @@ void P_SpawnSpecials (void)
 			// or ceiling texture, to distinguish floor and ceiling sky.
 
 			case Init_TransferSky:
-				for (s = -1; (s = P_FindSectorFromTag(lines[i].args[0],s)) >= 0;)
+				for (FSectorTagIterator itr(lines[i].args[0]); (s = itr.Next()) >= 0; )
 					sectors[s].sky = (i+1) | PL_SKYFLAT;
 				break;
 			}
@@ -1832,7 +1797,7 @@ static void P_SpawnScrollers(void)
 			register int s;
 
 		case Scroll_Ceiling:
-			for (s=-1; (s = P_FindSectorFromTag (l->args[0],s)) >= 0;)
+			for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 			{
 				new DScroller (DScroller::sc_ceiling, -dx, dy, control, s, accel);
 			}
@@ -1850,7 +1815,7 @@ static void P_SpawnScrollers(void)
 		case Scroll_Floor:
 			if (l->args[2] != 1)
 			{ // scroll the floor texture
-				for (s=-1; (s = P_FindSectorFromTag (l->args[0],s)) >= 0;)
+				for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				{
 					new DScroller (DScroller::sc_floor, -dx, dy, control, s, accel);
 				}
@@ -1867,7 +1832,7 @@ static void P_SpawnScrollers(void)
 
 			if (l->args[2] > 0)
 			{ // carry objects on the floor
-				for (s=-1; (s = P_FindSectorFromTag (l->args[0],s)) >= 0;)
+				for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				{
 					new DScroller (DScroller::sc_carry, dx, dy, control, s, accel);
 				}
@@ -1886,7 +1851,7 @@ static void P_SpawnScrollers(void)
 		// killough 3/1/98: scroll wall according to linedef
 		// (same direction and speed as scrolling floors)
 		case Scroll_Texture_Model:
-			for (s=-1; (s = P_FindLineFromID (l->args[0],s)) >= 0;)
+			for (FLineIdIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				if (s != i)
 					new DScroller (dx, dy, lines+s, control, accel);
 			break;
@@ -2041,7 +2006,7 @@ void P_SetSectorFriction (int tag, int amount, bool alterFlag)
 	// higher friction value actually means 'less friction'.
 	movefactor = FrictionToMoveFactor(friction);
 
-	for (s = -1; (s = P_FindSectorFromTag (tag,s)) >= 0; )
+	for (FSectorTagIterator itr(tag); (s = itr.Next()) >= 0; )
 	{
 		// killough 8/28/98:
 		//
@@ -2356,20 +2321,20 @@ static void P_SpawnPushers ()
 		switch (l->special)
 		{
 		case Sector_SetWind: // wind
-			for (s = -1; (s = P_FindSectorFromTag (l->args[0],s)) >= 0 ; )
+			for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				new DPusher (DPusher::p_wind, l->args[3] ? l : NULL, l->args[1], l->args[2], NULL, s);
 			l->special = 0;
 			break;
 
 		case Sector_SetCurrent: // current
-			for (s = -1; (s = P_FindSectorFromTag (l->args[0],s)) >= 0 ; )
+			for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				new DPusher (DPusher::p_current, l->args[3] ? l : NULL, l->args[1], l->args[2], NULL, s);
 			l->special = 0;
 			break;
 
 		case PointPush_SetForce: // push/pull
 			if (l->args[0]) {	// [RH] Find thing by sector
-				for (s = -1; (s = P_FindSectorFromTag (l->args[0], s)) >= 0 ; )
+				for (FSectorTagIterator itr(l->args[0]); (s = itr.Next()) >= 0; )
 				{
 					AActor *thing = P_GetPushThing (s);
 					if (thing) {	// No MT_P* means no effect
@@ -0,0 +1,238 @@
+/*
+** p_tags.cpp
+** Lookup of sectors by tag and lines by ID
+**
+**---------------------------------------------------------------------------
+**
+** The index is built once when a level is loaded and rebuilt whenever a
+** script changes tags. Entries whose sector or line no longer has the
+** tag they were indexed under are skipped, so an index that is out of
+** date can miss objects but never returns wrong ones.
+**
+*/
+
+#include <stdlib.h>
+
+#include "doomtype.h"
+#include "tarray.h"
+#include "r_defs.h"
+#include "r_state.h"
+#include "p_tags.h"
+
+FTagIndex SectorTags;
+FTagIndex LineIDs;
+
+struct FTagEntry
+{
+	int Tag;
+	int Item;
+};
+
+static int STACK_ARGS SortTagEntries (const void *a, const void *b)
+{
+	const FTagEntry *x = (const FTagEntry *)a;
+	const FTagEntry *y = (const FTagEntry *)b;
+
+	if (x->Tag != y->Tag)
+	{
+		return x->Tag < y->Tag ? -1 : 1;
+	}
+	return x->Item - y->Item;
+}
+
+//==========================================================================
+//
+// FTagIndex :: Build
+//
+//==========================================================================
+
+void FTagIndex::Build(const int *tags, int count)
+{
+	TArray<FTagEntry> entries(count);
+
+	entries.Resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		entries[i].Tag = tags[i];
+		entries[i].Item = i;
+	}
+	if (count > 0)
+	{
+		qsort(&entries[0], count, sizeof(FTagEntry), SortTagEntries);
+	}
+	Tags.Resize(count);
+	Items.Resize(count);
+	Pos.Resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Tags[i] = entries[i].Tag;
+		Items[i] = entries[i].Item;
+		Pos[entries[i].Item] = i;
+	}
+}
+
+//==========================================================================
+//
+// FTagIndex :: First
+//
+// Returns the first entry for tag whose item comes after the given one.
+// If there is none, the entry returned has a different tag or is past the
+// end.
+//
+//==========================================================================
+
+int FTagIndex::First(int tag, int after) const
+{
+	// The common case: continuing from the last item found.
+	if (after >= 0 && (unsigned)after < Pos.Size() && Tags[Pos[after]] == tag)
+	{
+		return Pos[after] + 1;
+	}
+
+	unsigned lo = 0, hi = Tags.Size();
+	while (lo < hi)
+	{
+		unsigned mid = (lo + hi) / 2;
+		if (Tags[mid] < tag || (Tags[mid] == tag && Items[mid] <= after))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+//==========================================================================
+//
+// FTagIndex :: Clear
+//
+//==========================================================================
+
+void FTagIndex::Clear()
+{
+	Tags.Clear();
+	Items.Clear();
+	Pos.Clear();
+}
+
+//==========================================================================
+//
+// P_InitTagLists
+//
+// Must be called again whenever a sector's tag or a line's ID changes.
+//
+//==========================================================================
+
+void P_InitTagLists ()
+{
+	TArray<int> tags;
+	int i;
+
+	tags.Resize(numsectors);
+	for (i = 0; i < numsectors; ++i)
+	{
+		tags[i] = sectors[i].tag;
+	}
+	SectorTags.Build(numsectors > 0 ? &tags[0] : NULL, numsectors);
+
+	tags.Resize(numlines);
+	for (i = 0; i < numlines; ++i)
+	{
+		tags[i] = lines[i].id;
+	}
+	LineIDs.Build(numlines > 0 ? &tags[0] : NULL, numlines);
+}
+
+//==========================================================================
+//
+// P_FreeTagLists
+//
+//==========================================================================
+
+void P_FreeTagLists ()
+{
+	SectorTags.Clear();
+	LineIDs.Clear();
+}
+
+//==========================================================================
+//
+// P_FindSectorFromTag
+//
+// Returns the next sector after start with the tag, or -1. Pass -1 for
+// start to find the first one.
+//
+//==========================================================================
+
+int P_FindSectorFromTag (int tag, int start)
+{
+	for (unsigned i = SectorTags.First(tag, start); i < SectorTags.Tags.Size() && SectorTags.Tags[i] == tag; ++i)
+	{
+		int sec = SectorTags.Items[i];
+		if (sectors[sec].tag == tag)
+		{
+			return sec;
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+// P_FindLineFromID
+//
+//==========================================================================
+
+int P_FindLineFromID (int id, int start)
+{
+	for (unsigned i = LineIDs.First(id, start); i < LineIDs.Tags.Size() && LineIDs.Tags[i] == id; ++i)
+	{
+		int line = LineIDs.Items[i];
+		if (lines[line].id == id)
+		{
+			return line;
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+// FSectorTagIterator :: Next
+//
+//==========================================================================
+
+int FSectorTagIterator::Next()
+{
+	while (Entry < SectorTags.Tags.Size() && SectorTags.Tags[Entry] == Tag)
+	{
+		int sec = SectorTags.Items[Entry++];
+		if (sectors[sec].tag == Tag)
+		{
+			return sec;
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+// FLineIdIterator :: Next
+//
+//==========================================================================
+
+int FLineIdIterator::Next()
+{
+	while (Entry < LineIDs.Tags.Size() && LineIDs.Tags[Entry] == ID)
+	{
+		int line = LineIDs.Items[Entry++];
+		if (lines[line].id == ID)
+		{
+			return line;
+		}
+	}
+	return -1;
+}
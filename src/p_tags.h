@@ -0,0 +1,60 @@
+#ifndef P_TAGS_H
+#define P_TAGS_H 1
+
+#include "tarray.h"
+
+// A sorted index from a tag to all sectors, or an ID to all lines, that
+// use it. Each tag's entries are contiguous and in ascending order.
+
+struct FTagIndex
+{
+	TArray<int> Tags;		// sorted tags, one per entry
+	TArray<int> Items;		// sector or line number of each entry
+	TArray<int> Pos;		// entry of each sector or line
+
+	void Build(const int *tags, int count);
+	int First(int tag, int after) const;
+	void Clear();
+};
+
+extern FTagIndex SectorTags;
+extern FTagIndex LineIDs;
+
+void P_InitTagLists ();
+void P_FreeTagLists ();
+
+int		P_FindSectorFromTag (int tag, int start);
+int		P_FindLineFromID (int id, int start);
+
+// Iterators over all sectors with a tag or all lines with an ID. They
+// return -1 once there are no more.
+
+class FSectorTagIterator
+{
+	int Tag;
+	unsigned Entry;
+
+public:
+	FSectorTagIterator(int tag)
+	{
+		Tag = tag;
+		Entry = SectorTags.First(tag, -1);
+	}
+	int Next();
+};
+
+class FLineIdIterator
+{
+	int ID;
+	unsigned Entry;
+
+public:
+	FLineIdIterator(int id)
+	{
+		ID = id;
+		Entry = LineIDs.First(id, -1);
+	}
+	int Next();
+};
+
+#endif
@@ -303,7 +303,8 @@ static AActor *SelectTeleDest (int tid, int tag, bool norandom)
 	{
 		int secnum = -1;
 
-		while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+		FSectorTagIterator itr(tag);
+		while ((secnum = itr.Next()) >= 0)
 		{
 			// Scanning the snext links of things in the sector will not work, because
 			// TeleportDests have MF_NOSECTOR set. So you have to search *everything*.
@@ -424,7 +425,7 @@ bool EV_SilentLineTeleport (line_t *line, int side, AActor *thing, int id, INTBO
 	if (side || thing->flags2 & MF2_NOTELEPORT || !line || line->sidedef[1] == NULL)
 		return false;
 
-	for (i = -1; (i = P_FindLineFromID (id, i)) >= 0; )
+	for (FLineIdIterator itr(id); (i = itr.Next()) >= 0; )
 	{
 		if (line-lines == i)
 			continue;
@@ -727,7 +728,8 @@ bool EV_TeleportSector (int tag, int source_tid, int dest_tid, bool fog, int gro
 	int secnum;
 
 	secnum = -1;
-	while ((secnum = P_FindSectorFromTag (tag, secnum)) >= 0)
+	FSectorTagIterator itr(tag);
+	while ((secnum = itr.Next()) >= 0)
 	{
 		msecnode_t *node;
 		const sector_t * const sec = &sectors[secnum];
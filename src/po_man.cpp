@@ -976,6 +976,7 @@ bool FPolyObj::MovePolyobj (int x, int y, bool force)
 {
 	FBoundingBox oldbounds = Bounds;
 	UnLinkPolyobj ();
+	P_InvalidateSightCache ();
 	DoMovePolyobj (x, y);
 
 	if (!force)
@@ -1060,6 +1061,7 @@ bool FPolyObj::RotatePolyobj (angle_t angle, bool fromsave)
 	an = (this->angle+angle)>>ANGLETOFINESHIFT;
 
 	UnLinkPolyobj();
+	P_InvalidateSightCache ();
 
 	for(unsigned i=0;i < Vertices.Size(); i++)
 	{
@@ -13,6 +13,7 @@
 #include "sdlvideo.h"
 #include "r_swrenderer.h"
 #include "version.h"
+#include "m_argv.h"
 
 #include <SDL.h>
 
@@ -353,9 +354,17 @@ SDLFB::SDLFB (int width, int height, bool fullscreen)
 	FString caption;
 	caption.Format(GAMESIG " %s (%s)", GetVersionString(), GetGitTime());
 
+	// -headless keeps the window from being shown, for benchmark runs on
+	// machines without a desktop (e.g. with SDL_VIDEODRIVER=offscreen).
+	Uint32 flags = fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0;
+	if (Args->CheckParm ("-headless"))
+	{
+		flags = SDL_WINDOW_HIDDEN;
+	}
+
 	Screen = SDL_CreateWindow (caption,
 		SDL_WINDOWPOS_UNDEFINED_DISPLAY(vid_adapter), SDL_WINDOWPOS_UNDEFINED_DISPLAY(vid_adapter),
-		width, height, (fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0));
+		width, height, flags);
 
 	if (Screen == NULL)
 		return;
@@ -707,8 +707,6 @@ struct sector_t
 	short		lightlevel;
 	short		seqType;		// this sector's sound sequence
 
-	int			nexttag,firsttag;	// killough 1/30/98: improves searches for tags.
-
 	int			sky;
 	FNameNoInit	SeqName;		// Sound sequence name. Setting seqType non-negative will override this.
 
@@ -981,7 +979,6 @@ struct line_t
 	fixed_t		Alpha;		// <--- translucency (0=invisibile, FRACUNIT=opaque)
 	int			id;			// <--- same as tag or set with Line_SetIdentification
 	int			args[5];	// <--- hexen-style arguments (expanded to ZDoom's full width)
-	int			firstid, nextid;
 	side_t		*sidedef[2];
 	//DWORD		sidenum[2];	// sidenum[1] will be NO_SIDE if one sided
 	fixed_t		bbox[4];	// bounding box, for the extent of the LineDef.
@@ -43,6 +43,8 @@
 #include "gi.h"
 #include "stats.h"
 #include "x86.h"
+#include "c_dispatch.h"
+#include "v_text.h"
 
 #undef RANGECHECK
 
@@ -82,6 +84,11 @@ void (*R_DrawSpanMaskedTranslucent)(void);
 void (*R_DrawSpanAddClamp)(void);
 void (*R_DrawSpanMaskedAddClamp)(void);
 void (STACK_ARGS *rt_map4cols)(int,int,int);
+void (STACK_ARGS *rt_add4cols)(int,int,int);
+void (STACK_ARGS *rt_addclamp4cols)(int,int,int);
+void (STACK_ARGS *rt_subclamp4cols)(int,int,int);
+void (STACK_ARGS *rt_revsubclamp4cols)(int,int,int);
+void (STACK_ARGS *rt_shaded4cols)(int,int,int);
 
 //
 // R_DrawColumn
@@ -99,8 +106,8 @@ fixed_t 		dc_texturemid;
 fixed_t			dc_texturefrac;
 int				dc_color;				// [RH] Color for column filler
 DWORD			dc_srccolor;
-DWORD			*dc_srcblend;			// [RH] Source and destination
-DWORD			*dc_destblend;			// blending lookups
+SPAN_TLS DWORD	*dc_srcblend;			// [RH] Source and destination
+SPAN_TLS DWORD	*dc_destblend;			// blending lookups
 
 // first pixel in a column (possibly virtual) 
 const BYTE*		dc_source;				
@@ -964,21 +971,21 @@ void R_DrawRevSubClampTranslatedColumnP_C ()
 extern "C" {
 int						ds_color;				// [RH] color for non-textured spans
 
-int 					ds_y;
-int 					ds_x1;
-int 					ds_x2;
+SPAN_TLS int 			ds_y;
+SPAN_TLS int 			ds_x1;
+SPAN_TLS int 			ds_x2;
 
-lighttable_t*			ds_colormap;
+SPAN_TLS lighttable_t*	ds_colormap;
 
-dsfixed_t 				ds_xfrac;
-dsfixed_t 				ds_yfrac;
-dsfixed_t 				ds_xstep;
-dsfixed_t 				ds_ystep;
-int						ds_xbits;
-int						ds_ybits;
+SPAN_TLS dsfixed_t 		ds_xfrac;
+SPAN_TLS dsfixed_t 		ds_yfrac;
+SPAN_TLS dsfixed_t 		ds_xstep;
+SPAN_TLS dsfixed_t 		ds_ystep;
+SPAN_TLS int			ds_xbits;
+SPAN_TLS int			ds_ybits;
 
 // start of a floor/ceiling tile image 
-const BYTE*				ds_source;
+SPAN_TLS const BYTE*	ds_source;
 
 // just for profiling
 int 					dscount;
@@ -2144,6 +2151,13 @@ void tmvline4_revsubclamp ()
 	} while (--count);
 }
 
+// The four column versions handed out by R_GetTransMaskDrawers.
+// R_InitColumnDrawers picks them.
+static void (*tmvline4_addfunc) () = tmvline4_add;
+static void (*tmvline4_addclampfunc) () = tmvline4_addclamp;
+static void (*tmvline4_subclampfunc) () = tmvline4_subclamp;
+static void (*tmvline4_revsubclampfunc) () = tmvline4_revsubclamp;
+
 
 //==========================================================================
 //
@@ -2184,6 +2198,9 @@ void R_InitColumnDrawers ()
 	{
 		rt_map4cols				= rt_map4cols_asm1;
 	}
+	rt_add4cols					= rt_add4cols_asm;
+	rt_addclamp4cols			= rt_addclamp4cols_asm;
+	rt_shaded4cols				= rt_shaded4cols_asm;
 #else
 	R_DrawColumnHoriz			= R_DrawColumnHorizP_C;
 	R_DrawColumn				= R_DrawColumnP_C;
@@ -2193,13 +2210,322 @@ void R_InitColumnDrawers ()
 	R_DrawSpan					= R_DrawSpanP_C;
 	R_DrawSpanMasked			= R_DrawSpanMaskedP_C;
 	rt_map4cols					= rt_map4cols_c;
+	rt_add4cols					= rt_add4cols_c;
+	rt_addclamp4cols			= rt_addclamp4cols_c;
+	rt_shaded4cols				= rt_shaded4cols_c;
 #endif
+	rt_subclamp4cols			= rt_subclamp4cols_c;
+	rt_revsubclamp4cols			= rt_revsubclamp4cols_c;
 	R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_C;
 	R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_C;
 	R_DrawSpanAddClamp			= R_DrawSpanAddClampP_C;
 	R_DrawSpanMaskedAddClamp	= R_DrawSpanMaskedAddClampP_C;
+	tmvline4_addfunc			= tmvline4_add;
+	tmvline4_addclampfunc		= tmvline4_addclamp;
+	tmvline4_subclampfunc		= tmvline4_subclamp;
+	tmvline4_revsubclampfunc	= tmvline4_revsubclamp;
+
+#ifdef RT_SSE2
+	if (CPU.bSSE2)
+	{
+#ifndef X86_ASM
+		// The assembly versions get patched by rt_draw4cols and
+		// R_SetSpanSource, so they are kept.
+		rt_add4cols				= rt_add4cols_sse2;
+		rt_addclamp4cols		= rt_addclamp4cols_sse2;
+		rt_shaded4cols			= rt_shaded4cols_sse2;
+		R_DrawSpan				= R_DrawSpanP_SSE2;
+#endif
+		rt_subclamp4cols		= rt_subclamp4cols_sse2;
+		rt_revsubclamp4cols		= rt_revsubclamp4cols_sse2;
+		R_DrawSpanTranslucent	= R_DrawSpanTranslucentP_SSE2;
+		R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_SSE2;
+		R_DrawSpanAddClamp		= R_DrawSpanAddClampP_SSE2;
+		R_DrawSpanMaskedAddClamp = R_DrawSpanMaskedAddClampP_SSE2;
+		tmvline4_addfunc		= tmvline4_add_sse2;
+		tmvline4_addclampfunc	= tmvline4_addclamp_sse2;
+		tmvline4_subclampfunc	= tmvline4_subclamp_sse2;
+		tmvline4_revsubclampfunc = tmvline4_revsubclamp_sse2;
+	}
+#endif
+}
+
+//==========================================================================
+//
+// CCMD drawerbench
+//
+// Runs the C and the SSE2 versions of the blending drawers over the same
+// random data, prints how long each took and checks that both produced
+// identical output.
+//
+//==========================================================================
+
+#ifdef RT_SSE2
+enum
+{
+	BENCH_HEIGHT = 200,
+	BENCH_SIZE = BENCH_HEIGHT*4,
+	BENCH_PASSES = 2000
+};
+
+struct FColumnBench
+{
+	const char *Name;
+	void (STACK_ARGS *C)(int,int,int);
+	void (STACK_ARGS *SSE2)(int,int,int);
+	bool Clamped;
+};
+
+struct FDrawerBench
+{
+	const char *Name;
+	void (*C)(void);
+	void (*SSE2)(void);
+	bool Clamped;
+};
+
+static void R_BenchReport (const char *name, cycle_t &c, cycle_t &sse2, const BYTE *destc, const BYTE *destsse2)
+{
+	bool same = memcmp (destc, destsse2, BENCH_SIZE) == 0;
+	Printf ("%-24s C %8.3f ms  SSE2 %8.3f ms  %s\n", name, c.TimeMS(), sse2.TimeMS(),
+		same ? "identical" : TEXTCOLOR_RED "MISMATCH");
 }
 
+CCMD (drawerbench)
+{
+	static const FColumnBench coldrawers[] =
+	{
+		{ "rt_add4cols",			rt_add4cols_c,			rt_add4cols_sse2,			false },
+		{ "rt_addclamp4cols",		rt_addclamp4cols_c,		rt_addclamp4cols_sse2,		true },
+		{ "rt_subclamp4cols",		rt_subclamp4cols_c,		rt_subclamp4cols_sse2,		true },
+		{ "rt_revsubclamp4cols",	rt_revsubclamp4cols_c,	rt_revsubclamp4cols_sse2,	true },
+		{ "rt_shaded4cols",			rt_shaded4cols_c,		rt_shaded4cols_sse2,		false },
+	};
+	static const FDrawerBench walldrawers[] =
+	{
+		{ "tmvline4_add",			tmvline4_add,			tmvline4_add_sse2,			false },
+		{ "tmvline4_addclamp",		tmvline4_addclamp,		tmvline4_addclamp_sse2,		true },
+		{ "tmvline4_subclamp",		tmvline4_subclamp,		tmvline4_subclamp_sse2,		true },
+		{ "tmvline4_revsubclamp",	tmvline4_revsubclamp,	tmvline4_revsubclamp_sse2,	true },
+	};
+	static const FDrawerBench spandrawers[] =
+	{
+		{ "R_DrawSpan",						R_DrawSpanP_C,						R_DrawSpanP_SSE2,					false },
+		{ "R_DrawSpanTranslucent",			R_DrawSpanTranslucentP_C,			R_DrawSpanTranslucentP_SSE2,		false },
+		{ "R_DrawSpanMaskedTranslucent",	R_DrawSpanMaskedTranslucentP_C,		R_DrawSpanMaskedTranslucentP_SSE2,	false },
+		{ "R_DrawSpanAddClamp",				R_DrawSpanAddClampP_C,				R_DrawSpanAddClampP_SSE2,			true },
+		{ "R_DrawSpanMaskedAddClamp",		R_DrawSpanMaskedAddClampP_C,		R_DrawSpanMaskedAddClampP_SSE2,		true },
+	};
+
+	if (!CPU.bSSE2)
+	{
+		Printf ("This processor does not support SSE2.\n");
+		return;
+	}
+
+	BYTE identity[256], alpha[256], texture[128*128], temp[BENCH_SIZE], start[BENCH_SIZE];
+	BYTE destc[BENCH_SIZE], destsse2[BENCH_SIZE];
+	DWORD seed = 1;
+	int i, j;
+
+	for (i = 0; i < 256; ++i)
+	{
+		identity[i] = i;
+		alpha[i] = i * 65 / 256;
+	}
+	for (i = 0; i < 128*128; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		// About a quarter of the texels are transparent for the masked drawers.
+		texture[i] = (seed >> 24) < 64 ? 0 : seed >> 24;
+	}
+	for (i = 0; i < BENCH_SIZE; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		temp[i] = seed >> 24;
+		seed = seed * 1664525 + 1013904223;
+		start[i] = seed >> 24;
+	}
+
+	BYTE *savedestorg = dc_destorg;
+	BYTE *savetemp = dc_temp;
+	int savepitch = dc_pitch;
+	int saveylookup = ylookup[0];
+	lighttable_t *savecolormap = dc_colormap;
+	DWORD *savesrcblend = dc_srcblend;
+	DWORD *savedestblend = dc_destblend;
+	int savecolor = dc_color;
+	BYTE *savedest = dc_dest;
+	int savecount = dc_count;
+	int savetmvlinebits = tmvlinebits;
+	DWORD savevplce[4], savevince[4];
+	BYTE *savepalookupoffse[4];
+	const BYTE *savebufplce[4];
+	lighttable_t *saveds_colormap = ds_colormap;
+	const BYTE *saveds_source = ds_source;
+	int saveds_xbits = ds_xbits, saveds_ybits = ds_ybits;
+	int saveds_y = ds_y, saveds_x1 = ds_x1, saveds_x2 = ds_x2;
+	dsfixed_t saveds_xfrac = ds_xfrac, saveds_yfrac = ds_yfrac;
+	dsfixed_t saveds_xstep = ds_xstep, saveds_ystep = ds_ystep;
+
+	memcpy (savevplce, vplce, sizeof(vplce));
+	memcpy (savevince, vince, sizeof(vince));
+	memcpy (savepalookupoffse, palookupoffse, sizeof(palookupoffse));
+	memcpy (savebufplce, bufplce, sizeof(bufplce));
+
+	// Each pass blends onto the result of the previous one, so any
+	// difference between the two versions is carried through to the end.
+	ylookup[0] = 0;
+	dc_temp = temp;
+	dc_pitch = 4;
+	dc_color = 0x80;
+	ds_colormap = identity;
+	ds_source = texture;
+
+	for (i = 0; i < (int)countof(coldrawers); ++i)
+	{
+		cycle_t c, sse2;
+
+		dc_srcblend = coldrawers[i].Clamped ? Col2RGB8_LessPrecision[48] : Col2RGB8[40];
+		dc_destblend = coldrawers[i].Clamped ? Col2RGB8_LessPrecision[40] : Col2RGB8[24];
+		// The shaded drawer uses the colormap for alpha, which goes up to 64.
+		dc_colormap = coldrawers[i].C == rt_shaded4cols_c ? alpha : identity;
+
+		memcpy (destc, start, BENCH_SIZE);
+		dc_destorg = destc;
+		c.Reset();
+		c.Clock();
+		for (j = 0; j < BENCH_PASSES; ++j) coldrawers[i].C (0, 0, BENCH_HEIGHT-1);
+		c.Unclock();
+
+		memcpy (destsse2, start, BENCH_SIZE);
+		dc_destorg = destsse2;
+		sse2.Reset();
+		sse2.Clock();
+		for (j = 0; j < BENCH_PASSES; ++j) coldrawers[i].SSE2 (0, 0, BENCH_HEIGHT-1);
+		sse2.Unclock();
+
+		R_BenchReport (coldrawers[i].Name, c, sse2, destc, destsse2);
+	}
+
+	// Each of the four wall columns samples its own 128 texel column at
+	// its own rate.
+	tmvlinebits = 32 - 7;
+	dc_count = BENCH_HEIGHT;
+	for (i = 0; i < 4; ++i)
+	{
+		bufplce[i] = texture + i*128;
+		palookupoffse[i] = identity;
+		vince[i] = 0x1234567 * (i + 1);
+	}
+
+	for (i = 0; i < (int)countof(walldrawers); ++i)
+	{
+		cycle_t c, sse2;
+
+		dc_srcblend = walldrawers[i].Clamped ? Col2RGB8_LessPrecision[48] : Col2RGB8[40];
+		dc_destblend = walldrawers[i].Clamped ? Col2RGB8_LessPrecision[40] : Col2RGB8[24];
+
+		memcpy (destc, start, BENCH_SIZE);
+		c.Reset();
+		c.Clock();
+		for (j = 0; j < BENCH_PASSES; ++j)
+		{
+			dc_dest = destc;
+			vplce[0] = vplce[1] = vplce[2] = vplce[3] = j * 0x7654321;
+			walldrawers[i].C ();
+		}
+		c.Unclock();
+
+		memcpy (destsse2, start, BENCH_SIZE);
+		sse2.Reset();
+		sse2.Clock();
+		for (j = 0; j < BENCH_PASSES; ++j)
+		{
+			dc_dest = destsse2;
+			vplce[0] = vplce[1] = vplce[2] = vplce[3] = j * 0x7654321;
+			walldrawers[i].SSE2 ();
+		}
+		sse2.Unclock();
+
+		R_BenchReport (walldrawers[i].Name, c, sse2, destc, destsse2);
+	}
+
+	// Both the common 64x64 case and a larger texture are run. The span
+	// length is deliberately not a multiple of 4.
+	for (int bits = 6; bits <= 7; ++bits)
+	{
+		ds_xbits = ds_ybits = bits;
+		ds_y = 0;
+		ds_x1 = 0;
+		ds_x2 = BENCH_SIZE - 2;
+
+		for (i = 0; i < (int)countof(spandrawers); ++i)
+		{
+			cycle_t c, sse2;
+			FString name;
+
+			dc_srcblend = spandrawers[i].Clamped ? Col2RGB8_LessPrecision[48] : Col2RGB8[40];
+			dc_destblend = spandrawers[i].Clamped ? Col2RGB8_LessPrecision[40] : Col2RGB8[24];
+			name.Format ("%s %dx%d", spandrawers[i].Name, 1 << bits, 1 << bits);
+
+			memcpy (destc, start, BENCH_SIZE);
+			dc_destorg = destc;
+			c.Reset();
+			c.Clock();
+			for (j = 0; j < BENCH_PASSES; ++j)
+			{
+				ds_xfrac = j * 0x1234567;	ds_yfrac = j * 0x7654321;
+				ds_xstep = 0x123456;		ds_ystep = 0xfedcba;
+				spandrawers[i].C ();
+			}
+			c.Unclock();
+
+			memcpy (destsse2, start, BENCH_SIZE);
+			dc_destorg = destsse2;
+			sse2.Reset();
+			sse2.Clock();
+			for (j = 0; j < BENCH_PASSES; ++j)
+			{
+				ds_xfrac = j * 0x1234567;	ds_yfrac = j * 0x7654321;
+				ds_xstep = 0x123456;		ds_ystep = 0xfedcba;
+				spandrawers[i].SSE2 ();
+			}
+			sse2.Unclock();
+
+			R_BenchReport (name, c, sse2, destc, destsse2);
+		}
+	}
+
+	dc_destorg = savedestorg;
+	dc_temp = savetemp;
+	dc_pitch = savepitch;
+	ylookup[0] = saveylookup;
+	dc_colormap = savecolormap;
+	dc_srcblend = savesrcblend;
+	dc_destblend = savedestblend;
+	dc_color = savecolor;
+	dc_dest = savedest;
+	dc_count = savecount;
+	tmvlinebits = savetmvlinebits;
+	memcpy (vplce, savevplce, sizeof(vplce));
+	memcpy (vince, savevince, sizeof(vince));
+	memcpy (palookupoffse, savepalookupoffse, sizeof(palookupoffse));
+	memcpy (bufplce, savebufplce, sizeof(bufplce));
+	ds_colormap = saveds_colormap;
+	ds_source = saveds_source;
+	ds_xbits = saveds_xbits;
+	ds_ybits = saveds_ybits;
+	ds_y = saveds_y;
+	ds_x1 = saveds_x1;
+	ds_x2 = saveds_x2;
+	ds_xfrac = saveds_xfrac;
+	ds_yfrac = saveds_yfrac;
+	ds_xstep = saveds_xstep;
+	ds_ystep = saveds_ystep;
+}
+#endif
+
 // [RH] Choose column drawers in a single place
 EXTERN_CVAR (Int, r_drawfuzz)
 EXTERN_CVAR (Bool, r_drawtrans)
@@ -2452,25 +2778,25 @@ bool R_GetTransMaskDrawers (fixed_t (**tmvline1)(), void (**tmvline4)())
 	if (colfunc == R_DrawAddColumnP_C)
 	{
 		*tmvline1 = tmvline1_add;
-		*tmvline4 = tmvline4_add;
+		*tmvline4 = tmvline4_addfunc;
 		return true;
 	}
 	if (colfunc == R_DrawAddClampColumnP_C)
 	{
 		*tmvline1 = tmvline1_addclamp;
-		*tmvline4 = tmvline4_addclamp;
+		*tmvline4 = tmvline4_addclampfunc;
 		return true;
 	}
 	if (colfunc == R_DrawSubClampColumnP_C)
 	{
 		*tmvline1 = tmvline1_subclamp;
-		*tmvline4 = tmvline4_subclamp;
+		*tmvline4 = tmvline4_subclampfunc;
 		return true;
 	}
 	if (colfunc == R_DrawRevSubClampColumnP_C)
 	{
 		*tmvline1 = tmvline1_revsubclamp;
-		*tmvline4 = tmvline4_revsubclamp;
+		*tmvline4 = tmvline4_revsubclampfunc;
 		return true;
 	}
 	return false;
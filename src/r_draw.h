@@ -25,6 +25,17 @@
 
 #include "r_defs.h"
 
+// The span drawing state is per thread so that R_DrawPlanes can have
+// worker threads draw spans. The assembly drawers access these variables
+// directly, so they must stay plain globals in assembly builds.
+#ifdef X86_ASM
+#define SPAN_TLS
+#elif defined(_MSC_VER)
+#define SPAN_TLS __declspec(thread)
+#else
+#define SPAN_TLS __thread
+#endif
+
 extern "C" int			ylookup[MAXHEIGHT];
 
 extern "C" int			dc_pitch;		// [RH] Distance between rows
@@ -38,8 +49,8 @@ extern "C" fixed_t		dc_texturemid;
 extern "C" fixed_t		dc_texturefrac;
 extern "C" int			dc_color;		// [RH] For flat colors (no texturing)
 extern "C" DWORD		dc_srccolor;
-extern "C" DWORD		*dc_srcblend;
-extern "C" DWORD		*dc_destblend;
+extern "C" SPAN_TLS DWORD	*dc_srcblend;
+extern "C" SPAN_TLS DWORD	*dc_destblend;
 
 // first pixel in a column
 extern "C" const BYTE*	dc_source;
@@ -80,6 +91,7 @@ extern void (STACK_ARGS *domvline4) ();
 extern void setupmvline (int);
 
 extern void setuptmvline (int);
+extern int tmvlinebits;
 
 // The Spectre/Invisibility effect.
 extern void (*R_DrawFuzzColumn)(void);
@@ -144,8 +156,8 @@ void rt_tlaterevsubclamp1col (int hx, int sx, int yl, int yh);
 void STACK_ARGS rt_map4cols_c (int sx, int yl, int yh);
 void STACK_ARGS rt_add4cols_c (int sx, int yl, int yh);
 void STACK_ARGS rt_addclamp4cols_c (int sx, int yl, int yh);
-void STACK_ARGS rt_subclamp4cols (int sx, int yl, int yh);
-void STACK_ARGS rt_revsubclamp4cols (int sx, int yl, int yh);
+void STACK_ARGS rt_subclamp4cols_c (int sx, int yl, int yh);
+void STACK_ARGS rt_revsubclamp4cols_c (int sx, int yl, int yh);
 
 void STACK_ARGS rt_tlate4cols (int sx, int yl, int yh);
 void STACK_ARGS rt_tlateadd4cols (int sx, int yl, int yh);
@@ -163,22 +175,41 @@ void STACK_ARGS rt_add4cols_asm (int sx, int yl, int yh);
 void STACK_ARGS rt_addclamp4cols_asm (int sx, int yl, int yh);
 }
 
+// SSE2 versions of the blending drawers. These exist for all x86 targets;
+// R_InitColumnDrawers only picks them if CPUID says they can be used.
+#if defined(__amd64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_X64)
+#define RT_SSE2
+void STACK_ARGS rt_add4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_addclamp4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_subclamp4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_revsubclamp4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_shaded4cols_sse2 (int sx, int yl, int yh);
+void R_DrawSpanP_SSE2 (void);
+void R_DrawSpanTranslucentP_SSE2 (void);
+void R_DrawSpanMaskedTranslucentP_SSE2 (void);
+void R_DrawSpanAddClampP_SSE2 (void);
+void R_DrawSpanMaskedAddClampP_SSE2 (void);
+void tmvline4_add_sse2 ();
+void tmvline4_addclamp_sse2 ();
+void tmvline4_subclamp_sse2 ();
+void tmvline4_revsubclamp_sse2 ();
+#endif
+
 extern void (STACK_ARGS *rt_map4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_add4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_addclamp4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_subclamp4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_revsubclamp4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_shaded4cols)(int sx, int yl, int yh);
 
 #ifdef X86_ASM
 #define rt_copy1col			rt_copy1col_asm
 #define rt_copy4cols		rt_copy4cols_asm
 #define rt_map1col			rt_map1col_asm
-#define rt_shaded4cols		rt_shaded4cols_asm
-#define rt_add4cols			rt_add4cols_asm
-#define rt_addclamp4cols	rt_addclamp4cols_asm
 #else
 #define rt_copy1col			rt_copy1col_c
 #define rt_copy4cols		rt_copy4cols_c
 #define rt_map1col			rt_map1col_c
-#define rt_shaded4cols		rt_shaded4cols_c
-#define rt_add4cols			rt_add4cols_c
-#define rt_addclamp4cols	rt_addclamp4cols_c
 #endif
 
 void rt_draw4cols (int sx);
@@ -233,22 +264,22 @@ void	R_FillSpan (void);
 extern "C" void			   R_SetupDrawSlab(const BYTE *colormap);
 extern "C" void STACK_ARGS R_DrawSlab(int dx, fixed_t v, int dy, fixed_t vi, const BYTE *vptr, BYTE *p);
 
-extern "C" int				ds_y;
-extern "C" int				ds_x1;
-extern "C" int				ds_x2;
+extern "C" SPAN_TLS int			ds_y;
+extern "C" SPAN_TLS int			ds_x1;
+extern "C" SPAN_TLS int			ds_x2;
 
-extern "C" lighttable_t*	ds_colormap;
+extern "C" SPAN_TLS lighttable_t*	ds_colormap;
 
-extern "C" dsfixed_t		ds_xfrac;
-extern "C" dsfixed_t		ds_yfrac;
-extern "C" dsfixed_t		ds_xstep;
-extern "C" dsfixed_t		ds_ystep;
-extern "C" int				ds_xbits;
-extern "C" int				ds_ybits;
+extern "C" SPAN_TLS dsfixed_t		ds_xfrac;
+extern "C" SPAN_TLS dsfixed_t		ds_yfrac;
+extern "C" SPAN_TLS dsfixed_t		ds_xstep;
+extern "C" SPAN_TLS dsfixed_t		ds_ystep;
+extern "C" SPAN_TLS int			ds_xbits;
+extern "C" SPAN_TLS int			ds_ybits;
 extern "C" fixed_t			ds_alpha;
 
 // start of a 64*64 tile image
-extern "C" const BYTE*		ds_source;
+extern "C" SPAN_TLS const BYTE*	ds_source;
 
 extern "C" int				ds_color;		// [RH] For flat color (no texturing)
 
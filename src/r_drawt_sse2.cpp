@@ -0,0 +1,480 @@
+/*
+** r_drawt_sse2.cpp
+** SSE2 versions of the blending column, wall and span drawers
+**
+**---------------------------------------------------------------------------
+**
+** The blending math for the translucent drawers works on four packed
+** 10:10:10 values at once here. The palette and colormap lookups on either
+** side of it remain scalar because SSE2 has no gather, so the results are
+** bit for bit the same as those of the C drawers in r_drawt.cpp and
+** r_draw.cpp.
+**
+** This file needs intrinsics enabled, so it must not contain anything that
+** may be called on a processor without SSE2.
+**
+*/
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "r_defs.h"
+#include "r_draw.h"
+#include "v_video.h"
+
+#ifdef RT_SSE2
+
+#include <emmintrin.h>
+
+//==========================================================================
+//
+// Fetches the blend values of four source and four destination pixels.
+//
+//==========================================================================
+
+static inline __m128i rt_fetch4 (const DWORD *table, const BYTE *colormap, const BYTE *source)
+{
+	return _mm_setr_epi32 (table[colormap[source[0]]], table[colormap[source[1]]],
+		table[colormap[source[2]]], table[colormap[source[3]]]);
+}
+
+static inline __m128i rt_fetchdest4 (const DWORD *table, const BYTE *dest)
+{
+	return _mm_setr_epi32 (table[dest[0]], table[dest[1]], table[dest[2]], table[dest[3]]);
+}
+
+//==========================================================================
+//
+// Folds four blended values back to RGB32k indices and writes the
+// matching palette entries to dest[0] .. dest[3].
+//
+//==========================================================================
+
+static inline void rt_store4 (BYTE *dest, __m128i a)
+{
+	DWORD idx[4];
+
+	a = _mm_and_si128 (a, _mm_srli_epi32 (a, 15));
+	_mm_storeu_si128 ((__m128i *)idx, a);
+	dest[0] = RGB32k[0][0][idx[0]];
+	dest[1] = RGB32k[0][0][idx[1]];
+	dest[2] = RGB32k[0][0][idx[2]];
+	dest[3] = RGB32k[0][0][idx[3]];
+}
+
+// The same for masked drawers: pixels whose texel is 0 are left alone.
+static inline void rt_store4masked (BYTE *dest, __m128i a, const BYTE *pix)
+{
+	DWORD idx[4];
+
+	a = _mm_and_si128 (a, _mm_srli_epi32 (a, 15));
+	_mm_storeu_si128 ((__m128i *)idx, a);
+	if (pix[0] != 0) dest[0] = RGB32k[0][0][idx[0]];
+	if (pix[1] != 0) dest[1] = RGB32k[0][0][idx[1]];
+	if (pix[2] != 0) dest[2] = RGB32k[0][0][idx[2]];
+	if (pix[3] != 0) dest[3] = RGB32k[0][0][idx[3]];
+}
+
+//==========================================================================
+//
+// The blend operations themselves.
+//
+//==========================================================================
+
+static inline __m128i rt_blendadd (__m128i fg, __m128i bg)
+{
+	return _mm_or_si128 (_mm_add_epi32 (fg, bg), _mm_set1_epi32 (0x1f07c1f));
+}
+
+static inline __m128i rt_blendaddclamp (__m128i fg, __m128i bg)
+{
+	__m128i a = _mm_add_epi32 (fg, bg);
+	__m128i b = _mm_and_si128 (a, _mm_set1_epi32 (0x40100400));
+
+	a = _mm_or_si128 (a, _mm_set1_epi32 (0x01f07c1f));
+	a = _mm_and_si128 (a, _mm_set1_epi32 (0x3fffffff));
+	b = _mm_sub_epi32 (b, _mm_srli_epi32 (b, 5));
+	return _mm_or_si128 (a, b);
+}
+
+// Computes fg - bg, clamped at 0.
+static inline __m128i rt_blendsubclamp (__m128i fg, __m128i bg)
+{
+	__m128i a = _mm_sub_epi32 (_mm_or_si128 (fg, _mm_set1_epi32 (0x40100400)), bg);
+	__m128i b = _mm_and_si128 (a, _mm_set1_epi32 (0x40100400));
+
+	b = _mm_sub_epi32 (b, _mm_srli_epi32 (b, 5));
+	a = _mm_and_si128 (a, b);
+	return _mm_or_si128 (a, _mm_set1_epi32 (0x01f07c1f));
+}
+
+//==========================================================================
+//
+// Four column drawers
+//
+//==========================================================================
+
+// Adds all four spans to the screen starting at sx without clamping.
+void STACK_ARGS rt_add4cols_sse2 (int sx, int yl, int yh)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	int pitch = dc_pitch;
+
+	do {
+		rt_store4 (dest, rt_blendadd (rt_fetch4 (fg2rgb, colormap, source), rt_fetchdest4 (bg2rgb, dest)));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+// Adds all four spans to the screen starting at sx with clamping.
+void STACK_ARGS rt_addclamp4cols_sse2 (int sx, int yl, int yh)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	int pitch = dc_pitch;
+
+	do {
+		rt_store4 (dest, rt_blendaddclamp (rt_fetch4 (fg2rgb, colormap, source), rt_fetchdest4 (bg2rgb, dest)));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+// Subtracts all four spans to the screen starting at sx with clamping.
+void STACK_ARGS rt_subclamp4cols_sse2 (int sx, int yl, int yh)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	int pitch = dc_pitch;
+
+	do {
+		rt_store4 (dest, rt_blendsubclamp (rt_fetch4 (fg2rgb, colormap, source), rt_fetchdest4 (bg2rgb, dest)));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+// Subtracts all four spans from the screen starting at sx with clamping.
+void STACK_ARGS rt_revsubclamp4cols_sse2 (int sx, int yl, int yh)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	int pitch = dc_pitch;
+
+	do {
+		rt_store4 (dest, rt_blendsubclamp (rt_fetchdest4 (bg2rgb, dest), rt_fetch4 (fg2rgb, colormap, source)));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+// Draws all four spans to the screen starting at sx, using the colormapped
+// values as the alpha of dc_color.
+void STACK_ARGS rt_shaded4cols_sse2 (int sx, int yl, int yh)
+{
+	int count = yh-yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fgstart = &Col2RGB8[0][dc_color];
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	int pitch = dc_pitch;
+
+	do {
+		int a0 = colormap[source[0]], a1 = colormap[source[1]];
+		int a2 = colormap[source[2]], a3 = colormap[source[3]];
+		__m128i fg = _mm_setr_epi32 (fgstart[a0<<8], fgstart[a1<<8], fgstart[a2<<8], fgstart[a3<<8]);
+		__m128i bg = _mm_setr_epi32 (Col2RGB8[64-a0][dest[0]], Col2RGB8[64-a1][dest[1]],
+			Col2RGB8[64-a2][dest[2]], Col2RGB8[64-a3][dest[3]]);
+		rt_store4 (dest, rt_blendadd (fg, bg));
+		source += 4;
+		dest += pitch;
+	} while (--count);
+}
+
+struct FBlendAdd
+{
+	__m128i operator() (__m128i fg, __m128i bg) const { return rt_blendadd (fg, bg); }
+};
+
+struct FBlendAddClamp
+{
+	__m128i operator() (__m128i fg, __m128i bg) const { return rt_blendaddclamp (fg, bg); }
+};
+
+struct FBlendSubClamp
+{
+	__m128i operator() (__m128i fg, __m128i bg) const { return rt_blendsubclamp (fg, bg); }
+};
+
+struct FBlendRevSubClamp
+{
+	__m128i operator() (__m128i fg, __m128i bg) const { return rt_blendsubclamp (bg, fg); }
+};
+
+//==========================================================================
+//
+// Masked wall drawers
+//
+// The four columns have texture positions of their own, which are stepped
+// together. Texels of 0 are transparent. Rows where all four are
+// transparent are skipped entirely.
+//
+//==========================================================================
+
+template<class Blend>
+static inline void tmvline4_sse2 (Blend blend)
+{
+	BYTE *dest = dc_dest;
+	int count = dc_count;
+	int pitch = dc_pitch;
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	__m128i place = _mm_loadu_si128 ((const __m128i *)vplce);
+	__m128i step = _mm_loadu_si128 ((const __m128i *)vince);
+	__m128i shift = _mm_cvtsi32_si128 (tmvlinebits);
+	DWORD spot[4];
+	BYTE pix[4];
+
+	do
+	{
+		_mm_storeu_si128 ((__m128i *)spot, _mm_srl_epi32 (place, shift));
+		pix[0] = bufplce[0][spot[0]];
+		pix[1] = bufplce[1][spot[1]];
+		pix[2] = bufplce[2][spot[2]];
+		pix[3] = bufplce[3][spot[3]];
+		if ((pix[0] | pix[1] | pix[2] | pix[3]) != 0)
+		{
+			__m128i fg = _mm_setr_epi32 (fg2rgb[palookupoffse[0][pix[0]]], fg2rgb[palookupoffse[1][pix[1]]],
+				fg2rgb[palookupoffse[2][pix[2]]], fg2rgb[palookupoffse[3][pix[3]]]);
+			rt_store4masked (dest, blend (fg, rt_fetchdest4 (bg2rgb, dest)), pix);
+		}
+		place = _mm_add_epi32 (place, step);
+		dest += pitch;
+	} while (--count);
+
+	_mm_storeu_si128 ((__m128i *)vplce, place);
+}
+
+void tmvline4_add_sse2 ()
+{
+	tmvline4_sse2 (FBlendAdd());
+}
+
+void tmvline4_addclamp_sse2 ()
+{
+	tmvline4_sse2 (FBlendAddClamp());
+}
+
+void tmvline4_subclamp_sse2 ()
+{
+	tmvline4_sse2 (FBlendSubClamp());
+}
+
+void tmvline4_revsubclamp_sse2 ()
+{
+	tmvline4_sse2 (FBlendRevSubClamp());
+}
+
+//==========================================================================
+//
+// Span drawers
+//
+// The texture coordinates of four consecutive pixels are stepped together.
+// Everything here is unsigned 32 bit arithmetic that wraps the same way
+// as it does in the C drawers. A span's last 0-3 pixels are done one at
+// a time. The masked drawers leave pixels with a texel of 0 alone.
+//
+//==========================================================================
+
+template<bool Masked, class Blend>
+static inline void R_DrawSpanBlendSSE2 (Blend blend)
+{
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+
+	dsfixed_t xfrac = ds_xfrac;
+	dsfixed_t yfrac = ds_yfrac;
+	dsfixed_t xstep = ds_xstep;
+	dsfixed_t ystep = ds_ystep;
+	int yshift = 32 - ds_ybits;
+	int xshift = yshift - ds_xbits;
+	int xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+
+	if (count >= 4)
+	{
+		__m128i xf = _mm_setr_epi32 (xfrac, xfrac + xstep, xfrac + xstep*2, xfrac + xstep*3);
+		__m128i yf = _mm_setr_epi32 (yfrac, yfrac + ystep, yfrac + ystep*2, yfrac + ystep*3);
+		__m128i xs = _mm_set1_epi32 (xstep*4);
+		__m128i ys = _mm_set1_epi32 (ystep*4);
+		__m128i xm = _mm_set1_epi32 (xmask);
+		__m128i xsh = _mm_cvtsi32_si128 (xshift);
+		__m128i ysh = _mm_cvtsi32_si128 (yshift);
+		DWORD spot[4];
+		BYTE tex[4];
+
+		do
+		{
+			__m128i s = _mm_add_epi32 (_mm_and_si128 (_mm_srl_epi32 (xf, xsh), xm), _mm_srl_epi32 (yf, ysh));
+			_mm_storeu_si128 ((__m128i *)spot, s);
+			tex[0] = source[spot[0]];
+			tex[1] = source[spot[1]];
+			tex[2] = source[spot[2]];
+			tex[3] = source[spot[3]];
+			if (!Masked || (tex[0] | tex[1] | tex[2] | tex[3]) != 0)
+			{
+				__m128i fg = _mm_setr_epi32 (fg2rgb[colormap[tex[0]]], fg2rgb[colormap[tex[1]]],
+					fg2rgb[colormap[tex[2]]], fg2rgb[colormap[tex[3]]]);
+				__m128i a = blend (fg, rt_fetchdest4 (bg2rgb, dest));
+				if (Masked)
+				{
+					rt_store4masked (dest, a, tex);
+				}
+				else
+				{
+					rt_store4 (dest, a);
+				}
+			}
+			xf = _mm_add_epi32 (xf, xs);
+			yf = _mm_add_epi32 (yf, ys);
+			dest += 4;
+			count -= 4;
+		} while (count >= 4);
+
+		xfrac = _mm_cvtsi128_si32 (xf);
+		yfrac = _mm_cvtsi128_si32 (yf);
+	}
+	while (count > 0)
+	{
+		int spot = ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+		BYTE texdata = source[spot];
+		if (!Masked || texdata != 0)
+		{
+			__m128i fg = _mm_cvtsi32_si128 (fg2rgb[colormap[texdata]]);
+			__m128i a = blend (fg, _mm_cvtsi32_si128 (bg2rgb[*dest]));
+			DWORD val = _mm_cvtsi128_si32 (a);
+			*dest = RGB32k[0][0][val & (val>>15)];
+		}
+		dest++;
+		xfrac += xstep;
+		yfrac += ystep;
+		count--;
+	}
+}
+
+// The plain span drawer has no blending, so only the texture coordinates
+// are done four at a time.
+void R_DrawSpanP_SSE2 (void)
+{
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+
+	dsfixed_t xfrac = ds_xfrac;
+	dsfixed_t yfrac = ds_yfrac;
+	dsfixed_t xstep = ds_xstep;
+	dsfixed_t ystep = ds_ystep;
+	int yshift = 32 - ds_ybits;
+	int xshift = yshift - ds_xbits;
+	int xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+
+	if (count >= 4)
+	{
+		__m128i xf = _mm_setr_epi32 (xfrac, xfrac + xstep, xfrac + xstep*2, xfrac + xstep*3);
+		__m128i yf = _mm_setr_epi32 (yfrac, yfrac + ystep, yfrac + ystep*2, yfrac + ystep*3);
+		__m128i xs = _mm_set1_epi32 (xstep*4);
+		__m128i ys = _mm_set1_epi32 (ystep*4);
+		__m128i xm = _mm_set1_epi32 (xmask);
+		__m128i xsh = _mm_cvtsi32_si128 (xshift);
+		__m128i ysh = _mm_cvtsi32_si128 (yshift);
+		DWORD spot[4];
+
+		do
+		{
+			__m128i s = _mm_add_epi32 (_mm_and_si128 (_mm_srl_epi32 (xf, xsh), xm), _mm_srl_epi32 (yf, ysh));
+			_mm_storeu_si128 ((__m128i *)spot, s);
+			dest[0] = colormap[source[spot[0]]];
+			dest[1] = colormap[source[spot[1]]];
+			dest[2] = colormap[source[spot[2]]];
+			dest[3] = colormap[source[spot[3]]];
+			xf = _mm_add_epi32 (xf, xs);
+			yf = _mm_add_epi32 (yf, ys);
+			dest += 4;
+			count -= 4;
+		} while (count >= 4);
+
+		xfrac = _mm_cvtsi128_si32 (xf);
+		yfrac = _mm_cvtsi128_si32 (yf);
+	}
+	while (count > 0)
+	{
+		int spot = ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+		*dest++ = colormap[source[spot]];
+		xfrac += xstep;
+		yfrac += ystep;
+		count--;
+	}
+}
+
+void R_DrawSpanTranslucentP_SSE2 (void)
+{
+	R_DrawSpanBlendSSE2<false> (FBlendAdd());
+}
+
+void R_DrawSpanMaskedTranslucentP_SSE2 (void)
+{
+	R_DrawSpanBlendSSE2<true> (FBlendAdd());
+}
+
+void R_DrawSpanAddClampP_SSE2 (void)
+{
+	R_DrawSpanBlendSSE2<false> (FBlendAddClamp());
+}
+
+void R_DrawSpanMaskedAddClampP_SSE2 (void)
+{
+	R_DrawSpanBlendSSE2<true> (FBlendAddClamp());
+}
+
+#endif
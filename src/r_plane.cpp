@@ -21,10 +21,10 @@
 //		 while maintaining a per column clipping list only.
 //		Moreover, the sky areas have to be determined.
 //
-// MAXVISPLANES is no longer a limit on the number of visplanes,
-// but a limit on the number of hash slots; larger numbers mean
-// better performance usually but after a point they are wasted,
-// and memory and time overheads creep in.
+// The number of hash slots is no longer a limit on the number of
+// visplanes; larger numbers mean better performance usually but after
+// a point they are wasted, and memory and time overheads creep in.
+// The hash now grows with the number of visplanes a frame needs.
 //
 // Lee Killough
 //
@@ -58,6 +58,7 @@
 #include "r_3dfloors.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "m_workers.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable:4244)
@@ -72,24 +73,58 @@ planefunction_t 		floorfunc;
 planefunction_t 		ceilingfunc;
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES 128    /* must be a power of 2 */
+#define MINVISPLANEHASH 128		/* must be a power of 2 */
+#define MAXVISPLANEHASH 8192	/* must be a power of 2 */
 
 // Avoid infinite recursion with stacked sectors by limiting them.
 #define MAX_SKYBOX_PLANES 1000
 
 // [RH] Allocate one extra for sky box planes.
-static visplane_t		*visplanes[MAXVISPLANES+1];	// killough
+static visplane_t		**visplanes;				// killough
+static int				VisplaneHashSize;
+static int				VisplaneHashBits;
 static visplane_t		*freetail;					// killough
 static visplane_t		**freehead = &freetail;		// killough
 
 visplane_t 				*floorplane;
 visplane_t 				*ceilingplane;
 
+// Visplanes allocated since the last full clear. The hash is resized to
+// fit this at the start of the next frame, when it is empty.
+static int				NumVisplanes;
+
+// Statistics from the last R_DrawPlanes, for stat visplanes.
+static int				StatVisplanes, StatUsedBuckets, StatLongestChain, StatMerged;
+
 // killough -- hash function for visplanes
-// Empirically verified to be fairly uniform:
+// Empirically verified to be fairly uniform. The multiply spreads it
+// over the whole table for the larger sizes.
 
-#define visplane_hash(picnum,lightlevel,height) \
-  ((unsigned)((picnum)*3+(lightlevel)+((height).d)*7) & (MAXVISPLANES-1))
+static inline unsigned visplane_hash (int picnum, int lightlevel, const secplane_t &height)
+{
+	return ((unsigned)(picnum*3 + lightlevel + height.d*7) * 0x9E3779B1u) >> (32 - VisplaneHashBits);
+}
+
+//==========================================================================
+//
+// R_ResizeVisplaneHash
+//
+// May only be called while the table is empty.
+//
+//==========================================================================
+
+static void R_ResizeVisplaneHash (int size)
+{
+	if (visplanes != NULL)
+	{
+		M_Free (visplanes);
+	}
+	VisplaneHashSize = size;
+	for (VisplaneHashBits = 0; (1 << VisplaneHashBits) < size; ++VisplaneHashBits)
+	{ }
+	visplanes = (visplane_t **)M_Malloc (sizeof(visplane_t *) * (size + 1));
+	memset (visplanes, 0, sizeof(visplane_t *) * (size + 1));
+}
 
 // These are copies of the main parameters used when drawing stacked sectors.
 // When you change the main parameters, you should copy them here too *unless*
@@ -153,6 +188,31 @@ extern "C" BYTE *ds_curcolormap, *ds_cursource, *ds_curtiltedsource;
 #endif
 void					R_DrawSinglePlane (visplane_t *, fixed_t alpha, bool additive, bool masked);
 
+// Number of threads drawing floor and ceiling spans. 0 uses all cores.
+CVAR (Int, r_threads, 1, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+// While R_DrawPlanes runs with more than one thread, spans of regular
+// flats are recorded instead of drawn. They are then drawn by the
+// threads in interleaved groups of screen rows. Every row is owned by
+// exactly one thread, which draws its spans in the recorded order, so the
+// output is identical to drawing them directly.
+struct FSpanCommand
+{
+	void (*Func)(void);
+	const BYTE *Source;
+	lighttable_t *Colormap;
+	DWORD *SrcBlend, *DestBlend;
+	dsfixed_t XFrac, YFrac, XStep, YStep;
+	int Y, X1, X2;
+	int XBits, YBits;
+};
+
+#define SPAN_ROWGROUP_SHIFT	2
+
+static TArray<FSpanCommand> DeferredSpans;
+static bool DeferSpans;
+static int SpanThreads;
+
 //==========================================================================
 //
 // R_InitPlanes
@@ -163,6 +223,10 @@ void					R_DrawSinglePlane (visplane_t *, fixed_t alpha, bool additive, bool mas
 
 void R_InitPlanes ()
 {
+	if (visplanes == NULL)
+	{
+		R_ResizeVisplaneHash (MINVISPLANEHASH);
+	}
 }
 
 //==========================================================================
@@ -176,7 +240,7 @@ void R_DeinitPlanes ()
 	fakeActive = 0;
 
 	// do not use R_ClearPlanes because at this point the screen pointer is no longer valid.
-	for (int i = 0; i <= MAXVISPLANES; i++)	// new code -- killough
+	for (int i = 0; i <= VisplaneHashSize; i++)	// new code -- killough
 	{
 		for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
 		{
@@ -189,6 +253,11 @@ void R_DeinitPlanes ()
 		free (pl);
 		pl = next;
 	}
+	freetail = NULL;
+	freehead = &freetail;
+	M_Free (visplanes);
+	visplanes = NULL;
+	VisplaneHashSize = 0;
 }
 
 //==========================================================================
@@ -238,7 +307,82 @@ void R_MapPlane (int y, int x1)
 	ds_x1 = x1;
 	ds_x2 = x2;
 
-	spanfunc ();
+	if (DeferSpans)
+	{
+		FSpanCommand &cmd = DeferredSpans[DeferredSpans.Reserve(1)];
+		cmd.Func = spanfunc;
+		cmd.Source = ds_source;
+		cmd.Colormap = ds_colormap;
+		cmd.SrcBlend = dc_srcblend;
+		cmd.DestBlend = dc_destblend;
+		cmd.XFrac = ds_xfrac;
+		cmd.YFrac = ds_yfrac;
+		cmd.XStep = ds_xstep;
+		cmd.YStep = ds_ystep;
+		cmd.Y = y;
+		cmd.X1 = x1;
+		cmd.X2 = x2;
+		cmd.XBits = ds_xbits;
+		cmd.YBits = ds_ybits;
+	}
+	else
+	{
+		spanfunc ();
+	}
+}
+
+//==========================================================================
+//
+// R_DrawSpanRows
+//
+// Draws all recorded spans that fall into one thread's rows. Since the
+// span variables are thread local this can run on any thread.
+//
+//==========================================================================
+
+static void R_DrawSpanRows (int job, void *)
+{
+	const FSpanCommand *cmd = &DeferredSpans[0];
+	const FSpanCommand *end = cmd + DeferredSpans.Size();
+	int numjobs = SpanThreads;
+
+	for (; cmd < end; ++cmd)
+	{
+		if ((cmd->Y >> SPAN_ROWGROUP_SHIFT) % numjobs != job)
+			continue;
+
+		ds_source = cmd->Source;
+		ds_colormap = cmd->Colormap;
+		dc_srcblend = cmd->SrcBlend;
+		dc_destblend = cmd->DestBlend;
+		ds_xfrac = cmd->XFrac;
+		ds_yfrac = cmd->YFrac;
+		ds_xstep = cmd->XStep;
+		ds_ystep = cmd->YStep;
+		ds_y = cmd->Y;
+		ds_x1 = cmd->X1;
+		ds_x2 = cmd->X2;
+		ds_xbits = cmd->XBits;
+		ds_ybits = cmd->YBits;
+		cmd->Func ();
+	}
+}
+
+//==========================================================================
+//
+// R_FlushDeferredSpans
+//
+// Must be called before anything else draws while spans are deferred.
+//
+//==========================================================================
+
+static void R_FlushDeferredSpans ()
+{
+	if (DeferredSpans.Size() > 0)
+	{
+		M_RunParallel (R_DrawSpanRows, NULL, SpanThreads, SpanThreads);
+		DeferredSpans.Clear();
+	}
 }
 
 //==========================================================================
@@ -503,7 +647,7 @@ void R_ClearPlanes (bool fullclear)
 	// Don't clear fake planes if not doing a full clear.
 	if (!fullclear)
 	{
-		for (i = 0; i <= MAXVISPLANES-1; i++)	// new code -- killough
+		for (i = 0; i <= VisplaneHashSize-1; i++)	// new code -- killough
 		{
 			for (visplane_t **probe = &visplanes[i]; *probe != NULL; )
 			{
@@ -524,7 +668,7 @@ void R_ClearPlanes (bool fullclear)
 	}
 	else
 	{
-		for (i = 0; i <= MAXVISPLANES; i++)	// new code -- killough
+		for (i = 0; i <= VisplaneHashSize; i++)	// new code -- killough
 		{
 			for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
 			{
@@ -532,6 +676,18 @@ void R_ClearPlanes (bool fullclear)
 			}
 		}
 
+		// Keep the average chain length at 2 or less.
+		int size = VisplaneHashSize;
+		while (size < MAXVISPLANEHASH && NumVisplanes > size * 2)
+		{
+			size <<= 1;
+		}
+		if (size != VisplaneHashSize)
+		{
+			R_ResizeVisplaneHash (size);
+		}
+		NumVisplanes = 0;
+
 		// opening / clipping determination
 		clearbufshort (floorclip, viewwidth, viewheight);
 		// [RH] clip ceiling to console bottom
@@ -567,6 +723,7 @@ static visplane_t *new_visplane (unsigned hash)
 		freehead = &freetail;
 	}
 
+	NumVisplanes++;
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
 	return check;
@@ -628,7 +785,7 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 	}
 
 	// New visplane algorithm uses hash table -- killough
-	hash = isskybox ? MAXVISPLANES : visplane_hash (picnum.GetIndex(), lightlevel, height);
+	hash = isskybox ? VisplaneHashSize : visplane_hash (picnum.GetIndex(), lightlevel, height);
 
 	for (check = visplanes[hash]; check; check = check->next)	// killough
 	{
@@ -781,7 +938,7 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 
 		if (pl->skybox != NULL && !pl->skybox->bInSkybox && (pl->picnum == skyflatnum || pl->skybox->bAlways) && viewactive)
 		{
-			hash = MAXVISPLANES;
+			hash = VisplaneHashSize;
 		}
 		else
 		{
@@ -1031,6 +1188,93 @@ static void R_DrawSkyStriped (visplane_t *pl)
 CVAR (Bool, tilt, false, 0);
 //CVAR (Int, pa, 0, 0)
 
+//==========================================================================
+//
+// R_MergeVisplanes
+//
+// R_CheckPlane has to start a new visplane whenever a plane reappears in
+// columns it already covers, so one floor often ends up split over several
+// visplanes with identical parameters. Those whose columns don't overlap
+// are joined again here. This way rows that cross the seams are drawn as
+// one span instead of several. Only regular flats of the view that is
+// being drawn are merged.
+//
+//==========================================================================
+
+static bool R_CanMergePlanes (const visplane_t *a, const visplane_t *b)
+{
+	return a->height == b->height &&
+		a->picnum == b->picnum &&
+		a->lightlevel == b->lightlevel &&
+		a->xoffs == b->xoffs &&
+		a->yoffs == b->yoffs &&
+		a->colormap == b->colormap &&
+		a->xscale == b->xscale &&
+		a->yscale == b->yscale &&
+		a->angle == b->angle &&
+		a->sky == 0 && b->sky == 0 &&
+		a->skybox == NULL && b->skybox == NULL &&
+		a->Alpha == b->Alpha &&
+		a->Additive == b->Additive &&
+		a->CurrentMirror == b->CurrentMirror &&
+		a->MirrorFlags == b->MirrorFlags &&
+		a->CurrentSkybox == b->CurrentSkybox;
+}
+
+static int R_MergeVisplanes ()
+{
+	int merged = 0;
+
+	for (int i = 0; i < VisplaneHashSize; i++)
+	{
+		for (visplane_t *pl = visplanes[i]; pl != NULL; pl = pl->next)
+		{
+			if (pl->CurrentMirror != CurrentMirror || pl->CurrentSkybox != CurrentSkybox ||
+				pl->sky != 0 || pl->picnum == skyflatnum || pl->minx > pl->maxx)
+			{
+				continue;
+			}
+			for (visplane_t **probe = &pl->next; *probe != NULL; )
+			{
+				visplane_t *other = *probe;
+				int x, x1, x2;
+
+				if (!R_CanMergePlanes (pl, other) || other->minx > other->maxx)
+				{
+					probe = &other->next;
+					continue;
+				}
+				x1 = MAX (pl->minx, other->minx);
+				x2 = MIN (pl->maxx, other->maxx);
+				for (x = x1; x <= x2 && (pl->top[x] == 0x7fff || other->top[x] == 0x7fff); ++x)
+				{ }
+				if (x <= x2)
+				{ // Both use a common column.
+					probe = &other->next;
+					continue;
+				}
+				for (x = other->minx; x <= other->maxx; ++x)
+				{
+					if (other->top[x] != 0x7fff)
+					{
+						pl->top[x] = other->top[x];
+						pl->bottom[x] = other->bottom[x];
+					}
+				}
+				pl->minx = MIN (pl->minx, other->minx);
+				pl->maxx = MAX (pl->maxx, other->maxx);
+
+				*probe = other->next;
+				other->next = NULL;
+				*freehead = other;
+				freehead = &other->next;
+				merged++;
+			}
+		}
+	}
+	return merged;
+}
+
 int R_DrawPlanes ()
 {
 	visplane_t *pl;
@@ -1039,9 +1283,18 @@ int R_DrawPlanes ()
 
 	ds_color = 3;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+#ifndef X86_ASM
+	SpanThreads = r_threads > 0 ? r_threads : M_GetCPUCount();
+	DeferSpans = SpanThreads > 1;
+#endif
+
+	StatMerged = R_MergeVisplanes ();
+	StatVisplanes = StatUsedBuckets = StatLongestChain = 0;
+
+	for (i = 0; i < VisplaneHashSize; i++)
 	{
-		for (pl = visplanes[i]; pl; pl = pl->next)
+		int chain = 0;
+		for (pl = visplanes[i]; pl; pl = pl->next, chain++)
 		{
 			// kg3D - draw only correct planes
 			if(pl->CurrentMirror != CurrentMirror || pl->CurrentSkybox != CurrentSkybox)
@@ -1052,7 +1305,12 @@ int R_DrawPlanes ()
 				R_DrawSinglePlane (pl, OPAQUE, false, false);
 			}
 		}
+		StatVisplanes += chain;
+		StatUsedBuckets += chain > 0;
+		StatLongestChain = MAX (StatLongestChain, chain);
 	}
+	R_FlushDeferredSpans ();
+	DeferSpans = false;
 	return vpcount;
 }
 
@@ -1064,7 +1322,7 @@ void R_DrawHeightPlanes(fixed_t height)
 
 	ds_color = 3;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+	for (i = 0; i < VisplaneHashSize; i++)
 	{
 		for (pl = visplanes[i]; pl; pl = pl->next)
 		{
@@ -1100,11 +1358,13 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 
 	if (r_drawflat)
 	{ // [RH] no texture mapping
+		R_FlushDeferredSpans ();
 		ds_color += 4;
 		R_MapVisPlane (pl, R_MapColoredPlane);
 	}
 	else if (pl->picnum == skyflatnum)
 	{ // sky flat
+		R_FlushDeferredSpans ();
 		R_DrawSkyPlane (pl);
 	}
 	else
@@ -1124,6 +1384,11 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		{ // Don't waste time on a masked texture if it isn't really masked.
 			masked = false;
 		}
+		bool tilted = !(r_drawflat || ((pl->height.a == 0 && pl->height.b == 0) && !tilt));
+		if (tilted)
+		{ // Tilted planes use more shared state than can sensibly be recorded.
+			R_FlushDeferredSpans ();
+		}
 		R_SetupSpanBits(tex);
 		pl->xscale = MulScale16 (pl->xscale, tex->xScale);
 		pl->yscale = MulScale16 (pl->yscale, tex->yScale);
@@ -1132,7 +1397,7 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		basecolormap = pl->colormap;
 		planeshade = LIGHT2SHADE(pl->lightlevel);
 
-		if (r_drawflat || ((pl->height.a == 0 && pl->height.b == 0) && !tilt))
+		if (!tilted)
 		{
 			R_DrawNormalPlane (pl, alpha, additive, masked);
 		}
@@ -1177,7 +1442,7 @@ void R_DrawSkyBoxes ()
 
 	numskyboxes = 0;
 
-	if (visplanes[MAXVISPLANES] == NULL)
+	if (visplanes[VisplaneHashSize] == NULL)
 		return;
 
 	R_3D_EnterSkybox();
@@ -1198,12 +1463,12 @@ void R_DrawSkyBoxes ()
 	int i;
 	visplane_t *pl;
 
-	for (pl = visplanes[MAXVISPLANES]; pl != NULL; pl = visplanes[MAXVISPLANES])
+	for (pl = visplanes[VisplaneHashSize]; pl != NULL; pl = visplanes[VisplaneHashSize])
 	{
 		// Pop the visplane off the list now so that if this skybox adds more
 		// skyboxes to the list, they will be drawn instead of skipped (because
 		// new skyboxes go to the beginning of the list instead of the end).
-		visplanes[MAXVISPLANES] = pl->next;
+		visplanes[VisplaneHashSize] = pl->next;
 		pl->next = NULL;
 
 		if (pl->maxx < pl->minx || !r_skyboxes || numskyboxes == MAX_SKYBOX_PLANES)
@@ -1357,7 +1622,7 @@ void R_DrawSkyBoxes ()
 
 	if(fakeActive) return;
 
-	for (*freehead = visplanes[MAXVISPLANES], visplanes[MAXVISPLANES] = NULL; *freehead; )
+	for (*freehead = visplanes[VisplaneHashSize], visplanes[VisplaneHashSize] = NULL; *freehead; )
 		freehead = &(*freehead)->next;
 }
 
@@ -1368,6 +1633,15 @@ ADD_STAT(skyboxes)
 	return out;
 }
 
+ADD_STAT(visplanes)
+{
+	FString out;
+	out.Format ("%d visplanes, %d merged, %d/%d buckets used, average chain %.2f, longest chain %d",
+		StatVisplanes, StatMerged, StatUsedBuckets, VisplaneHashSize,
+		StatUsedBuckets > 0 ? double(StatVisplanes) / StatUsedBuckets : 0., StatLongestChain);
+	return out;
+}
+
 //==========================================================================
 //
 // R_DrawSkyPlane
@@ -1816,7 +2090,7 @@ bool R_PlaneInitData ()
 	freetail = NULL;
 	freehead = &freetail;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+	for (i = 0; i < VisplaneHashSize; i++)
 	{
 		pl = visplanes[i];
 		visplanes[i] = NULL;
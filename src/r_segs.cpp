@@ -52,6 +52,7 @@
 #include "r_3dfloors.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "r_wallmips.h"
 
 #define WALLYREPEAT 8
 
@@ -1058,9 +1059,21 @@ void wallscan (int x1, int x2, short *uwal, short *dwal, fixed_t *swal, fixed_t
 
 	rw_pic->GetHeight();	// Make sure texture size is loaded
 	shiftval = rw_pic->HeightBits;
-	setupvline (32-shiftval);
 	yrepeat >>= 2 + shiftval;
 	texturemid = dc_texturemid << (16 - shiftval);
+
+	// Distant walls can be drawn from a smaller copy of the texture. Only
+	// the vline shift changes; the texture coordinates stay the same.
+	if (getcol == R_GetColumn)
+	{
+		int miplevel = R_SetupWallMip (rw_pic, x1, x2, swal, yrepeat);
+		if (miplevel > 0)
+		{
+			getcol = R_GetWallMipColumn;
+			shiftval -= miplevel;
+		}
+	}
+	setupvline (32-shiftval);
 	xoffset = rw_offset;
 	basecolormapdata = basecolormap->Maps;
 
@@ -2312,6 +2325,20 @@ ptrdiff_t R_NewOpening (ptrdiff_t len)
 }
 
 
+//
+// R_SetCanvasViewInfo
+// Tells a camera texture how far away and how wide this wall is.
+//
+
+static void R_SetCanvasViewInfo (FTexture *tex, int start, int stop)
+{
+	if (tex != NULL && tex->bHasCanvas)
+	{
+		static_cast<FCanvasTexture *>(tex)->SetViewInfo (
+			FIXED2DBL(MIN(WallC.sz1, WallC.sz2)), double(stop - start) / viewwidth);
+	}
+}
+
 //
 // R_StoreWallRange
 // A wall segment will be drawn between start and stop pixels (inclusive).
@@ -2336,6 +2363,10 @@ void R_StoreWallRange (int start, int stop)
 		R_NewWall (true);
 	}
 
+	R_SetCanvasViewInfo (midtexture, start, stop);
+	R_SetCanvasViewInfo (toptexture, start, stop);
+	R_SetCanvasViewInfo (bottomtexture, start, stop);
+
 	rw_offset = sidedef->GetTextureXOffset(side_t::mid);
 	rw_light = rw_lightleft + rw_lightstep * (start - WallC.sx1);
 
@@ -42,6 +42,8 @@
 #include "r_3dfloors.h"
 #include "textures/textures.h"
 #include "r_data/voxels.h"
+#include "m_benchmark.h"
+#include "r_wallmips.h"
 
 
 class FArchive;
@@ -51,6 +53,7 @@ void R_SetupFreelook();
 void R_InitRenderer();
 
 extern float LastFOV;
+extern cycle_t WallCycles, PlaneCycles, MaskedCycles;
 
 //==========================================================================
 //
@@ -109,6 +112,15 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 void FSoftwareRenderer::RenderView(player_t *player)
 {
 	R_RenderActorView (player->mo);
+	if (benchmarking)
+	{
+		// Must be done before the camera textures reuse the counters.
+		M_BenchStage ("walls", WallCycles.TimeMS());
+		M_BenchStage ("planes", PlaneCycles.TimeMS());
+		M_BenchStage ("masked", MaskedCycles.TimeMS());
+		M_BenchCount ("drawsegs", int(ds_p - drawsegs));
+		M_BenchCount ("vissprites", int(vissprite_p - vissprites));
+	}
 	// [RH] Let cameras draw onto textures that were visible this frame.
 	FCanvasTextureInfo::UpdateAll ();
 }
@@ -192,6 +204,18 @@ void FSoftwareRenderer::OnModeSet ()
 	screen->Unlock ();
 }
 
+//===========================================================================
+//
+// Textures may be deleted or replaced between levels, so nothing that
+// was derived from them may be kept.
+//
+//===========================================================================
+
+void FSoftwareRenderer::CleanLevelData()
+{
+	R_FlushWallMips ();
+}
+
 //===========================================================================
 //
 // 
@@ -34,6 +34,7 @@ struct FSoftwareRenderer : public FRenderer
 	void CopyStackedViewParameters();
 	void RenderTextureView (FCanvasTexture *tex, AActor *viewpoint, int fov);
 	sector_t *FakeFlat(sector_t *sec, sector_t *tempsec, int *floorlightlevel, int *ceilinglightlevel, bool back);
+	void CleanLevelData();
 
 };
 
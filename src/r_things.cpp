@@ -1730,6 +1730,72 @@ static void swap(vissprite_t *&a, vissprite_t *&b)
 }
 #endif
 
+//==========================================================================
+//
+// R_RadixSortVisSprites
+//
+// Does the same as stable_sort with sv_compare, but in linear time. The
+// keys are sorted a byte at a time, and passes where all keys share the
+// same byte are skipped.
+//
+//==========================================================================
+
+struct FSpriteSortKey
+{
+	DWORD Key;
+	vissprite_t *Sprite;
+};
+
+static TArray<FSpriteSortKey> SpriteSortKeys[2];
+
+static void R_RadixSortVisSprites ()
+{
+	int i;
+
+	SpriteSortKeys[0].Resize (vsprcount);
+	SpriteSortKeys[1].Resize (vsprcount);
+
+	FSpriteSortKey *src = &SpriteSortKeys[0][0];
+	FSpriteSortKey *dest = &SpriteSortKeys[1][0];
+
+	// Ascending keys for descending idepth.
+	for (i = 0; i < vsprcount; ++i)
+	{
+		src[i].Key = ~((DWORD)spritesorter[i]->idepth ^ 0x80000000u);
+		src[i].Sprite = spritesorter[i];
+	}
+
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		int counts[256];
+
+		memset (counts, 0, sizeof(counts));
+		for (i = 0; i < vsprcount; ++i)
+		{
+			counts[(src[i].Key >> shift) & 255]++;
+		}
+		if (counts[(src[0].Key >> shift) & 255] == vsprcount)
+		{
+			continue;
+		}
+		for (i = 0; i < 256; ++i)
+		{
+			counts[i] = (i > 0 ? counts[i-1] : 0) + counts[i];
+		}
+		// Walking backwards keeps it stable with end positions.
+		for (i = vsprcount; i-- > 0; )
+		{
+			dest[--counts[(src[i].Key >> shift) & 255]] = src[i];
+		}
+		std::swap (src, dest);
+	}
+
+	for (i = 0; i < vsprcount; ++i)
+	{
+		spritesorter[i] = src[i].Sprite;
+	}
+}
+
 void R_SortVisSprites (bool (*compare)(vissprite_t *, vissprite_t *), size_t first)
 {
 	int i;
@@ -1766,7 +1832,148 @@ void R_SortVisSprites (bool (*compare)(vissprite_t *, vissprite_t *), size_t fir
 		}
 	}
 
-	std::stable_sort(&spritesorter[0], &spritesorter[vsprcount], compare);
+	if (compare == sv_compare)
+	{
+		R_RadixSortVisSprites ();
+	}
+	else
+	{
+		std::stable_sort(&spritesorter[0], &spritesorter[vsprcount], compare);
+	}
+}
+
+//==========================================================================
+//
+// Drawseg index for sprite clipping
+//
+// R_DrawSprite used to look at every drawseg for every sprite. The
+// drawsegs are now bucketed by the screen columns they cover once per
+// masked pass, so a sprite only looks at those in the buckets it touches.
+// Each bucket lists its drawsegs from last to first, which is the order
+// R_DrawSprite has to process them in.
+//
+//==========================================================================
+
+#define DRAWSEG_BUCKET_SHIFT	5
+
+static TArray<int>			DrawSegBucketStart;	// one more than buckets
+static TArray<int>			DrawSegBucketSegs;
+static TArray<unsigned>		DrawSegStamps;
+static TArray<int>			SpriteDrawSegs;
+static unsigned				DrawSegStamp;
+static drawseg_t			*DrawSegIndexBase, *DrawSegIndexFirst, *DrawSegIndexEnd;
+
+static void R_BuildDrawSegIndex ()
+{
+	int numbuckets = ((viewwidth - 1) >> DRAWSEG_BUCKET_SHIFT) + 1;
+	int numsegs = int(ds_p - drawsegs);
+	drawseg_t *ds;
+	int b, total;
+
+	DrawSegBucketStart.Resize (numbuckets + 1);
+	memset (&DrawSegBucketStart[0], 0, sizeof(int) * (numbuckets + 1));
+
+	// Count the drawsegs in each bucket, then turn the counts into the
+	// positions after each bucket's end and fill the buckets backwards.
+	for (ds = firstdrawseg; ds < ds_p; ++ds)
+	{
+		if (ds->fake || ds->x1 > ds->x2) continue;
+		int b2 = MIN (ds->x2 >> DRAWSEG_BUCKET_SHIFT, numbuckets - 1);
+		for (b = ds->x1 >> DRAWSEG_BUCKET_SHIFT; b <= b2; ++b)
+		{
+			DrawSegBucketStart[b]++;
+		}
+	}
+	for (b = 0, total = 0; b <= numbuckets; ++b)
+	{
+		total += DrawSegBucketStart[b];
+		DrawSegBucketStart[b] = total;
+	}
+	DrawSegBucketSegs.Resize (total);
+	for (ds = firstdrawseg; ds < ds_p; ++ds)
+	{
+		if (ds->fake || ds->x1 > ds->x2) continue;
+		int b2 = MIN (ds->x2 >> DRAWSEG_BUCKET_SHIFT, numbuckets - 1);
+		for (b = ds->x1 >> DRAWSEG_BUCKET_SHIFT; b <= b2; ++b)
+		{
+			DrawSegBucketSegs[--DrawSegBucketStart[b]] = int(ds - drawsegs);
+		}
+	}
+
+	if (DrawSegStamps.Size() < (unsigned)numsegs)
+	{
+		DrawSegStamps.Resize (numsegs);
+		memset (&DrawSegStamps[0], 0, sizeof(unsigned) * numsegs);
+		DrawSegStamp = 0;
+	}
+	DrawSegIndexBase = drawsegs;
+	DrawSegIndexFirst = firstdrawseg;
+	DrawSegIndexEnd = ds_p;
+}
+
+static int STACK_ARGS R_CompareDrawSegsDescending (const void *a, const void *b)
+{
+	return *(const int *)b - *(const int *)a;
+}
+
+//==========================================================================
+//
+// R_GetSpriteDrawSegs
+//
+// Fills SpriteDrawSegs with the indices of the drawsegs that might cover
+// the columns x1 to x2, last drawseg first.
+//
+//==========================================================================
+
+static void R_GetSpriteDrawSegs (int x1, int x2)
+{
+	SpriteDrawSegs.Clear ();
+
+	if (DrawSegIndexBase != drawsegs || DrawSegIndexFirst != firstdrawseg || DrawSegIndexEnd != ds_p)
+	{ // No index for this set of drawsegs
+		for (drawseg_t *ds = ds_p; ds-- > firstdrawseg; )
+		{
+			SpriteDrawSegs.Push (int(ds - drawsegs));
+		}
+		return;
+	}
+
+	int numbuckets = DrawSegBucketStart.Size() - 1;
+	int b1 = MIN (x1 >> DRAWSEG_BUCKET_SHIFT, numbuckets - 1);
+	int b2 = MIN (x2 >> DRAWSEG_BUCKET_SHIFT, numbuckets - 1);
+
+	if (b1 == b2)
+	{
+		for (int i = DrawSegBucketStart[b1]; i < DrawSegBucketStart[b1 + 1]; ++i)
+		{
+			SpriteDrawSegs.Push (DrawSegBucketSegs[i]);
+		}
+		return;
+	}
+
+	// Drawsegs can be in several of the buckets, so keep only the
+	// first copy of each and restore the order afterwards.
+	if (++DrawSegStamp == 0)
+	{
+		memset (&DrawSegStamps[0], 0, sizeof(unsigned) * DrawSegStamps.Size());
+		DrawSegStamp = 1;
+	}
+	for (int b = b1; b <= b2; ++b)
+	{
+		for (int i = DrawSegBucketStart[b]; i < DrawSegBucketStart[b + 1]; ++i)
+		{
+			int seg = DrawSegBucketSegs[i];
+			if (DrawSegStamps[seg] != DrawSegStamp)
+			{
+				DrawSegStamps[seg] = DrawSegStamp;
+				SpriteDrawSegs.Push (seg);
+			}
+		}
+	}
+	if (SpriteDrawSegs.Size() > 1)
+	{
+		qsort (&SpriteDrawSegs[0], SpriteDrawSegs.Size(), sizeof(int), R_CompareDrawSegsDescending);
+	}
 }
 
 
@@ -2062,8 +2269,10 @@ void R_DrawSprite (vissprite_t *spr)
 
 	//		for (ds=ds_p-1 ; ds >= drawsegs ; ds--)    old buggy code
 
-	for (ds = ds_p; ds-- > firstdrawseg; )  // new -- killough
+	R_GetSpriteDrawSegs (x1, x2);
+	for (unsigned c = 0; c < SpriteDrawSegs.Size(); ++c)
 	{
+		ds = &drawsegs[SpriteDrawSegs[c]];
 		// kg3D - no clipping on fake segs
 		if(ds->fake) continue;
 		// determine if the drawseg obscures the sprite
@@ -2231,6 +2440,7 @@ void R_DrawHeightPlanes(fixed_t height); // kg3D - fake planes
 void R_DrawMasked (void)
 {
 	R_SortVisSprites (DrewAVoxel ? sv_compare2d : sv_compare, firstvissprite - vissprites);
+	R_BuildDrawSegIndex ();
 
 	if (height_top == NULL)
 	{ // kg3D - no visible 3D floors, normal rendering
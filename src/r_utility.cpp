@@ -27,6 +27,8 @@
 
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
+#include <limits.h>
 
 #include "templates.h"
 #include "doomdef.h"
@@ -89,6 +91,9 @@ CVAR (Bool, r_deathcamera, false, CVAR_ARCHIVE)
 CVAR (Int, r_clearbuffer, 0, 0)
 CVAR (Bool, r_drawvoxels, true, 0)
 CVAR (Bool, r_drawplayersprites, true, 0)	// [RH] Draw player sprites?
+CVAR (Int, r_camtexbudget, 4, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)		// max. camera textures rendered per frame, 0 = unlimited
+CVAR (Int, r_camtexmaxskip, 8, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)		// max. frames a visible camera texture may lag behind
+CVAR (Float, r_camtexfalloff, 512.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)	// distance per step of reduced camera update rate
 CUSTOM_CVAR(Float, r_quakeintensity, 1.0f, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
 	if (self < 0.f) self = 0.f;
@@ -145,6 +150,7 @@ int 			validcount = 1; 	// increment every time a check is made
 int				FieldOfView = 2048;		// Fineangles in the SCREENWIDTH wide window
 
 FCanvasTextureInfo *FCanvasTextureInfo::List;
+int FCanvasTextureInfo::FrameCount;
 
 
 // CODE --------------------------------------------------------------------
@@ -1033,34 +1039,122 @@ void FCanvasTextureInfo::Add (AActor *viewpoint, FTextureID picnum, int fov)
 	probe->Texture = texture;
 	probe->PicNum = picnum;
 	probe->FOV = fov;
+	probe->LastUpdate = FrameCount;
 	probe->Next = List;
 	texture->bFirstUpdate = true;
 	List = probe;
 }
 
+//==========================================================================
+//
+// FCanvasTextureInfo :: UpdateInterval
+//
+// Returns how many frames may pass between two updates of this camera,
+// based on how large and how far away its surfaces were in the last frame.
+//
+//==========================================================================
+
+int FCanvasTextureInfo::UpdateInterval () const
+{
+	int maxskip = MAX<int>(r_camtexmaxskip, 1);
+
+	// Not measured by the renderer, so it may be covering the whole screen.
+	if (Texture->ViewDist == FLT_MAX)
+	{
+		return 1;
+	}
+
+	int interval = 1;
+	if (r_camtexfalloff > 0)
+	{
+		interval += int(Texture->ViewDist / r_camtexfalloff);
+	}
+	if (Texture->ScreenFrac < 1./16)
+	{
+		interval *= 4;
+	}
+	else if (Texture->ScreenFrac < 1./4)
+	{
+		interval *= 2;
+	}
+	return MIN(interval, maxskip);
+}
+
 //==========================================================================
 //
 // FCanvasTextureInfo :: UpdateAll
 //
-// Updates all canvas textures that were visible in the last frame.
+// Updates canvas textures that were visible in the last frame. Only the
+// ones that are due according to their update interval are considered,
+// and no more than r_camtexbudget of them get rendered per frame. The
+// ones waiting longest relative to their interval go first, so skipped
+// cameras rotate to the front on subsequent frames.
 //
 //==========================================================================
 
+struct FCanvasUpdate
+{
+	FCanvasTextureInfo *Info;
+	int Urgency;
+};
+
+static int CompareCanvasUpdates (const void *a, const void *b)
+{
+	return ((const FCanvasUpdate *)b)->Urgency - ((const FCanvasUpdate *)a)->Urgency;
+}
+
 void FCanvasTextureInfo::UpdateAll ()
 {
+	static TArray<FCanvasUpdate> updates;
 	FCanvasTextureInfo *probe;
 
+	FrameCount++;
+	updates.Clear();
+
+	for (probe = List; probe != NULL; probe = probe->Next)
+	{
+		FCanvasTexture *tex = probe->Texture;
+
+		if (probe->Viewpoint != NULL && tex->bNeedsUpdate)
+		{
+			int age = FrameCount - probe->LastUpdate;
+			int interval = probe->UpdateInterval();
+
+			if (tex->bFirstUpdate || age >= interval)
+			{
+				FCanvasUpdate upd = { probe, tex->bFirstUpdate ? INT_MAX : age * 256 / interval };
+				updates.Push(upd);
+			}
+		}
+		tex->bNeedsUpdate = false;
+	}
+
+	unsigned count = updates.Size();
+	if (r_camtexbudget > 0 && count > (unsigned)r_camtexbudget)
+	{
+		qsort (&updates[0], count, sizeof(FCanvasUpdate), CompareCanvasUpdates);
+		count = r_camtexbudget;
+	}
+
 	// curse Doom's overuse of global variables in the renderer.
 	// These get clobbered by rendering to a camera texture but they need to be preserved so the final rendering can be done with the correct palette.
 	unsigned char *savecolormap = fixedcolormap;
 	FSpecialColormap *savecm = realfixedcolormap;
 
+	for (unsigned i = 0; i < count; ++i)
+	{
+		probe = updates[i].Info;
+		probe->LastUpdate = FrameCount;
+		Renderer->RenderTextureView(probe->Texture, probe->Viewpoint, probe->FOV);
+	}
+
+	// The view info is collected anew while the player's view is drawn.
+	// Resetting it only now drops what the camera views measured, so a
+	// monitor seen only by a camera doesn't keep its priority.
 	for (probe = List; probe != NULL; probe = probe->Next)
 	{
-		if (probe->Viewpoint != NULL && probe->Texture->bNeedsUpdate)
-		{
-			Renderer->RenderTextureView(probe->Texture, probe->Viewpoint, probe->FOV);
-		}
+		probe->Texture->ViewDist = FLT_MAX;
+		probe->Texture->ScreenFrac = 0;
 	}
 
 	fixedcolormap = savecolormap;
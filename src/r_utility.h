@@ -89,6 +89,7 @@ struct FCanvasTextureInfo
 	FCanvasTexture *Texture;
 	FTextureID PicNum;
 	int FOV;
+	int LastUpdate;		// frame number of the last time this camera was rendered
 
 	static void Add (AActor *viewpoint, FTextureID picnum, int fov);
 	static void UpdateAll ();
@@ -97,7 +98,10 @@ struct FCanvasTextureInfo
 	static void Mark();
 
 private:
+	int UpdateInterval () const;
+
 	static FCanvasTextureInfo *List;
+	static int FrameCount;
 };
 
 
@@ -0,0 +1,331 @@
+/*
+** r_wallmips.cpp
+** Reduced size wall textures for distant walls
+**
+**---------------------------------------------------------------------------
+**
+** Each level halves the texture in both directions. A level's pixels are
+** the average color of the 2x2 block it covers, matched back to the
+** palette through RGB32k. Levels are stored column-major like the pixels
+** returned by FTexture::GetPixels, so the regular wall drawers can use
+** them once the shift passed to setupvline has been adjusted.
+**
+** The levels of all textures share one memory budget. When it is
+** exceeded, the textures that have gone unused the longest are dropped.
+**
+*/
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "templates.h"
+#include "tarray.h"
+#include "v_video.h"
+#include "v_palette.h"
+#include "textures/textures.h"
+#include "r_wallmips.h"
+
+enum { MAX_WALLMIPS = 4 };
+
+struct FWallMipSet
+{
+	FTexture *Tex;
+	int NumLevels;
+	BYTE *Levels[MAX_WALLMIPS];		// Levels[0] is half size
+	int LevelHeight[MAX_WALLMIPS];
+	int Memory;
+	unsigned LastUse;
+};
+
+typedef TMap<FTexture *, FWallMipSet *> FWallMipMap;
+
+static FWallMipMap WallMips;
+static int WallMipMemory;
+static unsigned WallMipUseCount;
+
+static FWallMipSet *CurrentMip;
+static int CurrentLevel;
+
+//==========================================================================
+//
+// CVAR r_wallmips
+//
+// The highest mip level walls may use. 0 disables mipmapping.
+//
+//==========================================================================
+
+CUSTOM_CVAR (Int, r_wallmips, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+	else if (self > MAX_WALLMIPS)
+	{
+		self = MAX_WALLMIPS;
+	}
+	else
+	{
+		R_FlushWallMips ();
+	}
+}
+
+//==========================================================================
+//
+// CVAR r_wallmipcache
+//
+// Memory budget for the wall mip levels of all textures, in kilobytes.
+//
+//==========================================================================
+
+CUSTOM_CVAR (Int, r_wallmipcache, 8192, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 256)
+	{
+		self = 256;
+	}
+}
+
+//==========================================================================
+//
+// MakeLevel
+//
+// Builds a half size copy of a column-major image. Odd sizes are rounded
+// up and the missing row or column is taken from the edge. The result is
+// padded by one source-sized column so that drawers reading a full power
+// of 2 past the end of a non-power-of-2 column stay inside the buffer.
+//
+//==========================================================================
+
+static BYTE *MakeLevel (const BYTE *src, int srcwidth, int srcheight, int width, int height, int pad)
+{
+	BYTE *dest = new BYTE[width * height + pad];
+	const PalEntry *pal = GPalette.BaseColors;
+
+	for (int x = 0; x < width; ++x)
+	{
+		const BYTE *col1 = src + (x*2) * srcheight;
+		const BYTE *col2 = (x*2 + 1 < srcwidth) ? col1 + srcheight : col1;
+
+		for (int y = 0; y < height; ++y)
+		{
+			int y1 = y*2;
+			int y2 = (y1 + 1 < srcheight) ? y1 + 1 : y1;
+			const PalEntry &a = pal[col1[y1]], &b = pal[col1[y2]], &c = pal[col2[y1]], &d = pal[col2[y2]];
+			int r = (a.r + b.r + c.r + d.r) >> 2;
+			int g = (a.g + b.g + c.g + d.g) >> 2;
+			int bl = (a.b + b.b + c.b + d.b) >> 2;
+			dest[x * height + y] = RGB32k[r>>3][g>>3][bl>>3];
+		}
+	}
+	memset (dest + width * height, 0, pad);
+	return dest;
+}
+
+//==========================================================================
+//
+// FreeMipSet
+//
+//==========================================================================
+
+static void FreeMipSet (FWallMipSet *set)
+{
+	for (int i = 0; i < set->NumLevels; ++i)
+	{
+		delete[] set->Levels[i];
+	}
+	WallMipMemory -= set->Memory;
+	delete set;
+}
+
+//==========================================================================
+//
+// EvictWallMips
+//
+// Drops the least recently used textures until the cache fits its budget
+// again. The texture that is about to be drawn is never dropped.
+//
+//==========================================================================
+
+static void EvictWallMips (FWallMipSet *keep)
+{
+	while (WallMipMemory > r_wallmipcache * 1024)
+	{
+		FWallMipMap::Iterator it(WallMips);
+		FWallMipMap::Pair *pair;
+		FWallMipSet *oldest = NULL;
+
+		while (it.NextPair (pair))
+		{
+			if (pair->Value != keep && (oldest == NULL || pair->Value->LastUse < oldest->LastUse))
+			{
+				oldest = pair->Value;
+			}
+		}
+		if (oldest == NULL)
+		{
+			break;
+		}
+		WallMips.Remove (oldest->Tex);
+		FreeMipSet (oldest);
+	}
+}
+
+//==========================================================================
+//
+// GetMipSet
+//
+// Returns the texture's mip levels, building any that are missing up to
+// the requested one.
+//
+//==========================================================================
+
+static FWallMipSet *GetMipSet (FTexture *tex, int level)
+{
+	FWallMipSet **found = WallMips.CheckKey (tex);
+	FWallMipSet *set;
+
+	if (found != NULL)
+	{
+		set = *found;
+	}
+	else
+	{
+		set = new FWallMipSet;
+		memset (set, 0, sizeof(*set));
+		set->Tex = tex;
+		WallMips[tex] = set;
+	}
+	set->LastUse = ++WallMipUseCount;
+
+	if (set->NumLevels < level)
+	{
+		const BYTE *src = set->NumLevels > 0 ? set->Levels[set->NumLevels - 1] : tex->GetPixels ();
+		int width = (tex->GetWidth() + (1 << set->NumLevels) - 1) >> set->NumLevels;
+		int height = set->NumLevels > 0 ? set->LevelHeight[set->NumLevels - 1] : tex->GetHeight();
+
+		while (set->NumLevels < level)
+		{
+			int l = set->NumLevels;
+			int newwidth = (width + 1) >> 1;
+			int newheight = (height + 1) >> 1;
+			int pad = 1 << (tex->HeightBits - l - 1);
+
+			set->Levels[l] = MakeLevel (src, width, height, newwidth, newheight, pad);
+			set->LevelHeight[l] = newheight;
+			set->Memory += newwidth * newheight + pad;
+			WallMipMemory += newwidth * newheight + pad;
+			set->NumLevels++;
+
+			src = set->Levels[l];
+			width = newwidth;
+			height = newheight;
+		}
+		EvictWallMips (set);
+	}
+	return set;
+}
+
+//==========================================================================
+//
+// R_SetupWallMip
+//
+// Picks the mip level for a wall from its closest column, so no part of
+// the wall is drawn from a level with fewer texels than screen pixels.
+// vstep is wallscan's vertical step per unit of swal. Returns the level
+// to use, or 0 to draw from the texture itself. For levels above 0,
+// R_GetWallMipColumn returns the columns of the chosen level.
+//
+//==========================================================================
+
+int R_SetupWallMip (FTexture *tex, int x1, int x2, const fixed_t *swal, fixed_t vstep)
+{
+	if (r_wallmips <= 0 || tex->bWarped || tex->bHasCanvas || x2 < x1)
+	{
+		return 0;
+	}
+
+	fixed_t minswal = swal[x1];
+	for (int x = x1 + 1; x <= x2; ++x)
+	{
+		if (swal[x] < minswal) minswal = swal[x];
+	}
+	if (minswal <= 0)
+	{
+		return 0;
+	}
+
+	// Texels per screen pixel for the closest column.
+	QWORD texels = (QWORD(minswal) * QWORD(abs(vstep))) >> (32 - tex->HeightBits);
+	// At least one height bit has to be left for the vline drawers' shift.
+	int maxlevel = MIN<int> (r_wallmips, MIN (tex->HeightBits - 1, (int)tex->WidthBits));
+	int level = 0;
+
+	while (texels >= 2 && level < maxlevel)
+	{
+		texels >>= 1;
+		level++;
+	}
+	if (level > 0)
+	{
+		CurrentMip = GetMipSet (tex, level);
+		CurrentLevel = level;
+	}
+	return level;
+}
+
+//==========================================================================
+//
+// R_GetWallMipColumn
+//
+// Column getter for wallscan, wrapping the column the same way
+// R_GetColumn does before scaling it down to the current level.
+//
+//==========================================================================
+
+const BYTE *R_GetWallMipColumn (FTexture *tex, int col)
+{
+	int width = tex->GetWidth();
+
+	if (width == 1 << tex->WidthBits)
+	{
+		col &= width - 1;
+	}
+	else
+	{
+		col %= width;
+		if (col < 0) col += width;
+	}
+	col >>= CurrentLevel;
+	return CurrentMip->Levels[CurrentLevel - 1] + col * CurrentMip->LevelHeight[CurrentLevel - 1];
+}
+
+//==========================================================================
+//
+// R_FlushWallMips
+//
+// Must be called whenever textures may have been deleted or replaced.
+//
+//==========================================================================
+
+void R_FlushWallMips ()
+{
+	FWallMipMap::Iterator it(WallMips);
+	FWallMipMap::Pair *pair;
+
+	while (it.NextPair (pair))
+	{
+		FreeMipSet (pair->Value);
+	}
+	WallMips.Clear ();
+	CurrentMip = NULL;
+	CurrentLevel = 0;
+}
+
+ADD_STAT (wallmips)
+{
+	FString out;
+	out.Format ("%d textures, %d KB of %d KB", WallMips.CountUsed(), WallMipMemory >> 10, *r_wallmipcache);
+	return out;
+}
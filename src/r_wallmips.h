@@ -0,0 +1,14 @@
+#ifndef __R_WALLMIPS_H__
+#define __R_WALLMIPS_H__
+
+class FTexture;
+
+// Reduced size copies of wall textures for the software renderer. Walls
+// that are far enough away to skip texels are drawn from a smaller copy,
+// which aliases less and touches much less memory.
+
+int R_SetupWallMip (FTexture *tex, int x1, int x2, const fixed_t *swal, fixed_t vstep);
+const BYTE *R_GetWallMipColumn (FTexture *tex, int col);
+void R_FlushWallMips ();
+
+#endif
@@ -33,6 +33,8 @@
 **
 */
 
+#include <float.h>
+
 #include "doomtype.h"
 #include "files.h"
 #include "v_palette.h"
@@ -59,6 +61,8 @@ FCanvasTexture::FCanvasTexture (const char *name, int width, int height)
 	bHasCanvas = true;
 	bFirstUpdate = true;
 	bPixelsAllocated = false;
+	ViewDist = FLT_MAX;
+	ScreenFrac = 0;
 }
 
 FCanvasTexture::~FCanvasTexture ()
@@ -603,6 +603,11 @@ public:
 	bool CheckModified ();
 	void NeedUpdate() { bNeedsUpdate=true; }
 	void SetUpdated() { bNeedsUpdate = false; bDidUpdate = true; bFirstUpdate = false; }
+	void SetViewInfo(double dist, double screenfrac)
+	{
+		if (dist < ViewDist) ViewDist = dist;
+		if (screenfrac > ScreenFrac) ScreenFrac = screenfrac;
+	}
 	DSimpleCanvas *GetCanvas() { return Canvas; }
 	void MakeTexture ();
 
@@ -614,6 +619,12 @@ protected:
 	bool bNeedsUpdate;
 	bool bDidUpdate;
 	bool bPixelsAllocated;
+
+	// How prominent the texture was on screen during the last frame.
+	// Renderers that can't tell leave these alone, which keeps the camera
+	// at full update rate.
+	double ViewDist;
+	double ScreenFrac;
 public:
 	bool bFirstUpdate;
 
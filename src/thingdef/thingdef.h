@@ -191,6 +191,7 @@ struct AFuncDesc
 };
 
 AFuncDesc *FindFunction(const char * string);
+const char *FindFunctionName(actionf_p func);
 
 
 void ParseStates(FScanner &sc, FActorInfo *actor, AActor *defaults, Baggage &bag);
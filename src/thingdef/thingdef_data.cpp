@@ -502,6 +502,24 @@ FPropertyInfo *FindProperty(const char * string)
 	return NULL;
 }
 
+//==========================================================================
+//
+// Find a function's name from its address. This is slow.
+//
+//==========================================================================
+
+const char *FindFunctionName(actionf_p func)
+{
+	for (unsigned i = 0; i < AFTable.Size(); i++)
+	{
+		if (AFTable[i].Function == func)
+		{
+			return AFTable[i].Name;
+		}
+	}
+	return NULL;
+}
+
 //==========================================================================
 //
 // Find a function by name using a binary search
@@ -34,15 +34,34 @@
 
 #include "doomtype.h"
 #include "i_system.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "m_workers.h"
 #include "v_palette.h"
 #include "v_pfx.h"
 
+EXTERN_CVAR (Int, r_threads)
+
 extern "C"
 {
 	PfxUnion GPfxPal;
 	PfxState GPfx;
 }
 
+typedef void (*PfxConvertFunc) (BYTE *src, int srcpitch,
+	void *dest, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+
+// The converter selected by SetFormat. GPfx.Convert points to
+// ConvertParallel instead, which splits the screen between threads.
+static PfxConvertFunc ConvertFunc;
+static int ConvertBytes;
+
+// Fewer rows than this per thread aren't worth handing out.
+enum { MIN_CONVERT_ROWS = 32 };
+
 static bool AnalyzeMask (DWORD mask, BYTE *shift);
 
 static void Palette16Generic (const PalEntry *pal);
@@ -67,6 +86,9 @@ static void Convert24 (BYTE *src, int srcpitch,
 static void Convert32 (BYTE *src, int srcpitch,
 	void *destin, int destpitch, int destwidth, int destheight,
 	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+static void ConvertParallel (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
 
 void PfxState::SetFormat (int bits, uint32 redMask, uint32 greenMask, uint32 blueMask)
 {
@@ -146,6 +168,15 @@ void PfxState::SetFormat (int bits, uint32 redMask, uint32 greenMask, uint32 blu
 		GreenLeft = AnalyzeMask (greenMask, &GreenShift);
 		BlueLeft = AnalyzeMask (blueMask, &BlueShift);
 	}
+
+	// Scale8's pixel doubling paths step through rows in groups and
+	// can't be split at arbitrary rows, so it always runs alone.
+	ConvertFunc = Convert;
+	ConvertBytes = abs(bits) >> 3;
+	if (Convert != Scale8)
+	{
+		Convert = ConvertParallel;
+	}
 }
 
 static bool AnalyzeMask (DWORD mask, BYTE *shiftout)
@@ -689,3 +720,148 @@ static void Convert32 (BYTE *src, int srcpitch,
 		}
 	}
 }
+
+// Threaded conversion -----------------------------------------------------
+
+struct FConvertJob
+{
+	PfxConvertFunc Func;
+	BYTE *Src;
+	int SrcPitch;
+	BYTE *Dest;
+	int DestPitch;
+	int DestWidth, DestHeight;
+	fixed_t XStep, YStep, XFrac, YFrac;
+	int BandHeight;
+};
+
+//==========================================================================
+//
+// ConvertBand
+//
+// Converts one band of rows. The source row and fraction the band starts
+// at are worked out the same way the converters step through them, so
+// the result matches converting the whole screen in one go.
+//
+//==========================================================================
+
+static void ConvertBand (int job, void *data)
+{
+	const FConvertJob *cj = (const FConvertJob *)data;
+	int y = job * cj->BandHeight;
+	int height = MIN (cj->BandHeight, cj->DestHeight - y);
+	BYTE *src = cj->Src;
+	fixed_t yfrac = cj->YFrac;
+
+	if (y > 0)
+	{
+		if (cj->XStep == FRACUNIT && cj->YStep == FRACUNIT)
+		{
+			src += y * cj->SrcPitch;
+		}
+		else
+		{
+			SQWORD pos = (SQWORD)yfrac + (SQWORD)y * cj->YStep;
+			src += (int)(pos >> FRACBITS) * cj->SrcPitch;
+			yfrac = (fixed_t)(pos & (FRACUNIT-1));
+		}
+	}
+	cj->Func (src, cj->SrcPitch, cj->Dest + y * cj->DestPitch, cj->DestPitch,
+		cj->DestWidth, height, cj->XStep, cj->YStep, cj->XFrac, yfrac);
+}
+
+//==========================================================================
+//
+// ConvertParallel
+//
+// Gamma and palette flashes are already part of GPfxPal, so converting
+// is nothing but table lookups, and the screen is simply split into
+// bands of rows for r_threads threads.
+//
+//==========================================================================
+
+static void ConvertParallel (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac)
+{
+	int threads = r_threads > 0 ? r_threads : M_GetCPUCount();
+
+	threads = MIN (threads, destheight / MIN_CONVERT_ROWS);
+	if (threads <= 1 || ystep <= 0)
+	{
+		ConvertFunc (src, srcpitch, destin, destpitch, destwidth, destheight, xstep, ystep, xfrac, yfrac);
+		return;
+	}
+
+	FConvertJob cj;
+	cj.Func = ConvertFunc;
+	cj.Src = src;
+	cj.SrcPitch = srcpitch;
+	cj.Dest = (BYTE *)destin;
+	cj.DestPitch = destpitch;
+	cj.DestWidth = destwidth;
+	cj.DestHeight = destheight;
+	cj.XStep = xstep;
+	cj.YStep = ystep;
+	cj.XFrac = xfrac;
+	cj.YFrac = yfrac;
+	cj.BandHeight = (destheight + threads - 1) / threads;
+	M_RunParallel (ConvertBand, &cj, (destheight + cj.BandHeight - 1) / cj.BandHeight, threads);
+}
+
+//==========================================================================
+//
+// CCMD pfxbench
+//
+// Times converting a random screen to the current display format at
+// common resolutions, on one thread and on r_threads threads.
+//
+//==========================================================================
+
+CCMD (pfxbench)
+{
+	static const int sizes[][2] =
+	{
+		{ 640, 480 }, { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }
+	};
+	const int passes = 20;
+
+	if (ConvertFunc == NULL)
+	{
+		Printf ("No display format has been set.\n");
+		return;
+	}
+
+	for (unsigned i = 0; i < countof(sizes); ++i)
+	{
+		int width = sizes[i][0], height = sizes[i][1];
+		int pitch = width * MAX (ConvertBytes, 1);
+		BYTE *src = new BYTE[width * height];
+		BYTE *dest = new BYTE[pitch * height];
+		DWORD seed = 1;
+		cycle_t single, threaded;
+		int j;
+
+		for (j = 0; j < width * height; ++j)
+		{
+			seed = seed * 1664525 + 1013904223;
+			src[j] = seed >> 24;
+		}
+
+		single.Reset();
+		single.Clock();
+		for (j = 0; j < passes; ++j) ConvertFunc (src, width, dest, pitch, width, height, FRACUNIT, FRACUNIT, 0, 0);
+		single.Unclock();
+
+		threaded.Reset();
+		threaded.Clock();
+		for (j = 0; j < passes; ++j) GPfx.Convert (src, width, dest, pitch, width, height, FRACUNIT, FRACUNIT, 0, 0);
+		threaded.Unclock();
+
+		Printf ("%4dx%-4d  1 thread %7.3f ms  %d threads %7.3f ms\n", width, height,
+			single.TimeMS() / passes, r_threads > 0 ? *r_threads : M_GetCPUCount(), threaded.TimeMS() / passes);
+
+		delete[] src;
+		delete[] dest;
+	}
+}
@@ -57,6 +57,9 @@
 #include "r_data/r_translate.h"
 #include "f_wipe.h"
 #include "m_png.h"
+#include "m_misc.h"
+#include "m_workers.h"
+#include "md5.h"
 #include "colormatcher.h"
 #include "v_palette.h"
 #include "r_sky.h"
@@ -156,6 +159,8 @@ CVAR (Int, vid_defbits, 8, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, vid_fps, false, 0)
 CVAR (Bool, ticker, false, 0)
 CVAR (Int, vid_showpalette, 0, 0)
+CVAR (Bool, vid_cachetranstable, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+EXTERN_CVAR (Int, r_threads)
 
 CUSTOM_CVAR (Bool, vid_vsync, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 {
@@ -642,6 +647,108 @@ int V_GetColor (const DWORD *palette, const char *str)
 	return res;
 }
 
+//==========================================================================
+//
+// RGB32k caching
+//
+// The RGB555 table is the only blending table that needs palette matching,
+// which makes it by far the slowest to build. It is kept in the cache
+// directory under the MD5 of the palette it was built for. The other
+// tables are straight arithmetic and are cheaper to build than to load.
+//
+//==========================================================================
+
+static const BYTE RGB32kCacheMagic[4] = { 'R','5','5','1' };
+
+static FString RGB32kCacheName (const PalEntry *palette, bool create)
+{
+	BYTE rgb[256*3];
+	BYTE digest[16];
+	MD5Context md5;
+
+	for (int i = 0; i < 256; ++i)
+	{
+		rgb[i*3+0] = palette[i].r;
+		rgb[i*3+1] = palette[i].g;
+		rgb[i*3+2] = palette[i].b;
+	}
+	md5.Update (rgb, sizeof(rgb));
+	md5.Final (digest);
+
+	FString path = M_GetCachePath (create);
+	if (create) CreatePath (path);
+	path << "/rgb32k-";
+	for (int i = 0; i < 16; ++i)
+	{
+		path.AppendFormat ("%02x", digest[i]);
+	}
+	path << ".bin";
+	return path;
+}
+
+static bool LoadRGB32k (const PalEntry *palette)
+{
+	FString path = RGB32kCacheName (palette, false);
+	FILE *f = fopen (path, "rb");
+	BYTE magic[4];
+	BYTE table[32*32*32];
+	bool ok;
+
+	if (f == NULL)
+	{
+		return false;
+	}
+	ok = fread (magic, 1, 4, f) == 4 && memcmp (magic, RGB32kCacheMagic, 4) == 0 &&
+		 fread (table, 1, sizeof(table), f) == sizeof(table);
+	fclose (f);
+
+	// Spot check the file in case it was damaged.
+	for (int i = 0; ok && i < 32*32*32; i += 1021)
+	{
+		int r = i >> 10, g = (i >> 5) & 31, b = i & 31;
+		ok = table[i] == ColorMatcher.Pick ((r<<3)|(r>>2), (g<<3)|(g>>2), (b<<3)|(b>>2));
+	}
+	if (ok)
+	{
+		memcpy (RGB32k, table, sizeof(table));
+	}
+	return ok;
+}
+
+static void SaveRGB32k (const PalEntry *palette)
+{
+	FString path = RGB32kCacheName (palette, true);
+	FILE *f = fopen (path, "wb");
+
+	if (f != NULL)
+	{
+		if (fwrite (RGB32kCacheMagic, 1, 4, f) != 4 || fwrite (RGB32k, 1, sizeof(RGB32k), f) != sizeof(RGB32k))
+		{
+			Printf ("Error saving blending table to %s\n", path.GetChars());
+		}
+		fclose (f);
+	}
+}
+
+//==========================================================================
+//
+// BuildRGB32kSlice
+//
+// Fills in one red level of the RGB555 table. Each slice falls in its own
+// set of FColorMatcher cells, so every job gets a private copy of the
+// matcher and none of the work is done twice.
+//
+//==========================================================================
+
+static void BuildRGB32kSlice (int r, void *data)
+{
+	FColorMatcher matcher (*(const FColorMatcher *)data);
+
+	for (int g = 0; g < 32; g++)
+		for (int b = 0; b < 32; b++)
+			RGB32k[r][g][b] = matcher.Pick ((r<<3)|(r>>2), (g<<3)|(g>>2), (b<<3)|(b>>2));
+}
+
 //==========================================================================
 //
 // BuildTransTable
@@ -652,13 +759,15 @@ int V_GetColor (const DWORD *palette, const char *str)
 
 static void BuildTransTable (const PalEntry *palette)
 {
-	int r, g, b;
-
 	// create the RGB555 lookup table
-	for (r = 0; r < 32; r++)
-		for (g = 0; g < 32; g++)
-			for (b = 0; b < 32; b++)
-				RGB32k[r][g][b] = ColorMatcher.Pick ((r<<3)|(r>>2), (g<<3)|(g>>2), (b<<3)|(b>>2));
+	if (!vid_cachetranstable || !LoadRGB32k (palette))
+	{
+		M_RunParallel (BuildRGB32kSlice, &ColorMatcher, 32, r_threads > 0 ? r_threads : M_GetCPUCount());
+		if (vid_cachetranstable)
+		{
+			SaveRGB32k (palette);
+		}
+	}
 
 	int x, y;
 